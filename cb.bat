@@ -20,6 +20,7 @@ set cb_output=cb.exe
 set cb_include_dir=%~dp0
 set cb_pedantic=
 set cb_cxflags=
+set "cb_run_args="
 @REM --------------------------------------------------------------------------------
 @REM Parse Arguments
 @REM --------------------------------------------------------------------------------
@@ -32,6 +33,7 @@ if not "%1"=="" (
     if "%1"=="clang"             set "cb_clang=1" && set "cb_msvc="
     @REM options                 
     if "%1"=="run"               set "cb_run=1"
+    if "%1"=="bench"             set "cb_run_args=bench"
     if "%1"=="--pedantic"        set "cb_pedantic=1"
     if "%1"=="--file"            set "cb_file=%2" && SHIFT
     if "%1"=="--include-dir"     set "cb_include_dir=%2" && SHIFT
@@ -54,6 +56,7 @@ echo.
 echo    help                  Display help
 echo    msvc                  Using MSVC, the only option supported so far. [default]
 echo    run                   Run the builder once it's compiled [default]
+echo    bench                 Run the preprocessor benchmark instead of the tests
 echo    --file    [filename]  Input c file to compile.
 echo    --output  [path]      The output full path of the generated executable
 echo    --tmp-dir [directory] Temporary directory for intermediate objects.
@@ -96,7 +99,7 @@ if "%cb_clang%"=="1" (
  
 if "%cb_run%"=="1" (
     echo [%cb_script%] Running "%cb_output%"
-    %cb_output% || goto error
+    %cb_output% %cb_run_args% || goto error
 )
 
 @REM --------------------------------------------------------------------------------
@@ -111,6 +114,7 @@ set "cb_tmp_dir="
 set "cb_include_dir="
 set "cb_file="
 set "cb_run="
+set "cb_run_args="
 set "cb_clang="
 set "cb_msvc="
 set "cb_help="
@@ -7,6 +7,11 @@
 #include "cb/cb_add_files.h"
 #include "cb/cb_assert.h"
 
+#include <stdint.h> /* uint32_t */
+#ifndef _WIN32
+#include <time.h>   /* clock_gettime */
+#endif
+
 /* STRV_IMPLEMENTATION is defined at the bottom of this file. */
 #include "src/external/re.lib/c/re/strv.h"
 #include "src/external/re.lib/c/re/strv_extensions.h"
@@ -36,6 +41,12 @@ void test_preprocessor(const char* exe, const char* directory);
 void test_error(const char* exe, const char* directory);
 void test_generated_source(const char* exe, const char* directory);
 void test_program_output(const char* exe, const char* directory);
+void test_pch(const char* exe, const char* directory);
+void test_pch_program_output(const char* exe, const char* directory);
+void emit_pch(const char* exe, const char* directory);
+void test_library(const char* directory);
+void bench_preprocessors(const char* ac_exe, const char* directory);
+void bench_generate_corpus(const char* directory);
 
 enum test_type {
 	/* Test the content of "file.g.c" against "file.g.c.expect". */
@@ -46,7 +57,7 @@ enum test_type {
 
 void test_generated_source_or_program_output(const char* exe, const char* directory, enum test_type type);
 
-int main()
+int main(int argc, char** argv)
 {
 	cb_init();
 
@@ -55,6 +66,15 @@ int main()
 	
  	file_to_c_str("static_predefines", "./src/ac/predefines.h", "./src/ac/predefines.g.h");
 
+	/* "cb.sh bench": compare the preprocessing time of the release build with the installed compilers. */
+	if (argc > 1 && strcmp(argv[1], "bench") == 0)
+	{
+		const char* ac_exe = build_with("Release");
+		bench_preprocessors(ac_exe, "./.build/bench/");
+		cb_destroy();
+		return 0;
+	}
+
 	build_with("Release");
 
 	cb_clear(); /* Clear all values of cb. */
@@ -74,6 +94,8 @@ int main()
 	test_preprocessor(ac_exe, "./tests/preprocessor_line/");
 	test_generated_source(ac_exe, "./tests/preprocessor_embed/");
 
+	test_library("./tests/library/");
+
 	test_error(ac_exe, "./tests/preprocessor_message/");
 	test_error(ac_exe, "./tests/errors/preprocessor/");
 	test_error(ac_exe, "./tests/errors/parsing/");
@@ -84,6 +106,15 @@ int main()
 	test_preprocessor(ac_exe, "./tests/options/preprocess_preserve_comment/");
 	test_preprocessor(ac_exe, "./tests/options/gcc_e/");
 	test_preprocessor(ac_exe, "./tests/options/gcc_multiple_short/");
+	test_pch(ac_exe, "./tests/options/pch/");
+	test_pch_program_output(ac_exe, "./tests/options/pch_compile/");
+	test_preprocessor(ac_exe, "./tests/options/scan_deps/");
+	test_preprocessor(ac_exe, "./tests/options/scan_deps_json/");
+	test_preprocessor(ac_exe, "./tests/options/multiple_files/");
+	test_preprocessor(ac_exe, "./tests/options/arenas_chunks/");
+	test_preprocessor(ac_exe, "./tests/options/arenas_huge_pages/");
+	test_program_output(ac_exe, "./tests/options/arenas_chunks_compile/");
+	test_program_output(ac_exe, "./tests/options/arenas_huge_pages_compile/");
 
 	cb_destroy();
 
@@ -130,12 +161,16 @@ void my_project(const char* project_name, const char* toolchain, const char* con
 	}
 	else if (cb_str_equals(toolchain, "gcc"))
 	{
+		cb_add(cb_CXFLAGS, "-pthread");   /* Multiple files are compiled on a thread pool */
+		cb_add(cb_LIBRARIES, "pthread");
+
 		if (is_debug)
 		{
 			cb_add(cb_CXFLAGS, "-g");    /* Produce debugging information  */
 			cb_add(cb_CXFLAGS, "-p");    /* Profile compilation (in case of performance analysis)  */
 			cb_add(cb_CXFLAGS, "-O0");   /* Disable optimization */
 			cb_add(cb_DEFINES, "DEBUG"); /* Add DEBUG constant define */
+			cb_add(cb_DEFINES, "AC_STATS"); /* Compile in the hot path counters (--stats) */
 		}
 		else
 		{
@@ -492,6 +527,34 @@ void test_error(const char* exe, const char* directory)
 	test_output(exe, directory, output_type_STDERR, new_line_insensitive);
 }
 
+/* Create precompiled header from prelude.h then preprocess the files using it. */
+void test_pch(const char* exe, const char* directory)
+{
+	emit_pch(exe, directory);
+	test_preprocessor(exe, directory);
+}
+
+/* Create precompiled header from prelude.h then compile and run the files using it. */
+void test_pch_program_output(const char* exe, const char* directory)
+{
+	emit_pch(exe, directory);
+	test_program_output(exe, directory);
+}
+
+void emit_pch(const char* exe, const char* directory)
+{
+	assert_path(exe);
+	assert_path(directory);
+
+	dstr cmd;
+	dstr_init(&cmd);
+
+	dstr_assign_f(&cmd, "%s --emit-pch %sprelude.g.acpch %sprelude.h", exe, directory, directory);
+	assert_process(cmd.data);
+
+	dstr_destroy(&cmd);
+}
+
 void test_generated_source(const char* exe, const char* directory)
 {
 	test_generated_source_or_program_output(exe, directory, test_type_SOURCE);
@@ -568,6 +631,54 @@ void test_generated_source_or_program_output(const char* exe, const char* direct
 	dstr_destroy(&cmd);
 }
 
+/* Count library tests to have a unique project name. */
+static int library_test_count = 0;
+
+/* Build each file with the library then run it, the test passes if it returns 0. */
+void test_library(const char* directory)
+{
+	assert_path(directory);
+
+	cb_toolchain_t toolchain = cb_toolchain_default_c();
+
+	cb_file_it it;
+	cb_file_it_init(&it, directory);
+
+	while (cb_file_it_get_next_glob(&it, "*.c"))
+	{
+		const char* file = cb_file_it_current_file(&it);
+
+		printf("Testing: %s \n", file);
+
+		/* Same flags as the library, the debug build is sanitized. */
+		char project_name[64];
+		library_test_count += 1;
+		sprintf(project_name, "library_test_%d", library_test_count);
+		my_project(project_name, toolchain.name, "Debug");
+
+		cb_add(cb_LINK_PROJECTS, "aclib");
+		cb_add(cb_FILES, file);
+		cb_set(cb_BINARY_TYPE, cb_EXE);
+
+		cb_add(cb_INCLUDE_DIRECTORIES, "./src/ac");
+		cb_add(cb_INCLUDE_DIRECTORIES, "./src/external/re.lib/c");
+		cb_add(cb_INCLUDE_DIRECTORIES, "./src/external/re.lib/cpp");
+		cb_add(cb_INCLUDE_DIRECTORIES, "./src/");
+
+		const char* exe = cb_bake();
+		if (!exe)
+		{
+			exit(1);
+		}
+
+		assert_run(exe);
+
+		printf("OK\n");
+	}
+
+	cb_file_it_destroy(&it);
+}
+
 /* Count generated project to have a unique id. */
 static int generated_project_count = 0;
 
@@ -587,6 +698,370 @@ void build_generated_exe_and_run(const char* file)
 	assert_run(generated_exe);
 }
 
+/*
+    Preprocessor benchmark.
+    A synthetic corpus is generated, then preprocessed by ac and by the compilers found in the PATH.
+    The corpus is deterministic so that results can be compared from one run to another.
+*/
+
+enum {
+	BENCH_ITERATIONS = 5,      /* The minimum time of all iterations is reported. */
+	BENCH_DEEP_DEPTH = 24,     /* Depth of the include chain, lower than the maximum of ac. */
+	BENCH_GUARD_COUNT = 256,   /* Headers with include guards, they include each other. */
+	BENCH_GUARD_LAYERS = 8,    /* A guarded header only includes headers of the previous layer. */
+	BENCH_GUARD_INCLUDES = 8,  /* Number of #include per guarded header. */
+	BENCH_XTABLE_SIZE = 2000,  /* Entries of the X-macro table. */
+	BENCH_CHAIN_SIZE = 200,    /* Object-like macros referring to the previous one. */
+	BENCH_COMMENT_BLOCKS = 2000,
+	BENCH_LITERAL_COUNT = 40000,
+};
+
+typedef struct bench_preprocessor bench_preprocessor;
+struct bench_preprocessor {
+	const char* name;
+	const char* exe;        /* Full path of the executable, NULL if not installed. */
+	const char* arguments;  /* Arguments to preprocess into the standard output. */
+	double min_seconds;
+	const char* output_status;
+};
+
+static uint32_t bench_random_state = 0x9E3779B9;
+
+/* Deterministic pseudo random number (xorshift32). */
+uint32_t bench_random()
+{
+	uint32_t x = bench_random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	bench_random_state = x;
+	return x;
+}
+
+double bench_time_seconds()
+{
+#if _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+/* Returns the full path of the executable if it's in the PATH, NULL otherwise.
+   The returned string is allocated with cb_tmp_sprintf. */
+const char* bench_find_in_path(const char* exe_name)
+{
+#if _WIN32
+	const char separator = ';';
+	const char* extension = ".exe";
+#else
+	const char separator = ':';
+	const char* extension = "";
+#endif
+
+	const char* path = getenv("PATH");
+	while (path && *path)
+	{
+		const char* end = strchr(path, separator);
+		size_t size = end ? (size_t)(end - path) : strlen(path);
+
+		if (size)
+		{
+			const char* candidate = cb_tmp_sprintf("%.*s/%s%s", (int)size, path, exe_name, extension);
+			if (re_file_exists_str(candidate))
+			{
+				return candidate;
+			}
+		}
+
+		path = end ? end + 1 : NULL;
+	}
+	return NULL;
+}
+
+void bench_write_file(const char* directory, const char* filename, dstr* content)
+{
+	const char* filepath = cb_tmp_sprintf("%s%s", directory, filename);
+	FILE* file = re_file_open(filepath, "wb");
+	if (!file)
+	{
+		fprintf(stderr, "Can't create file: %s\n", filepath);
+		exit(1);
+	}
+	fwrite(content->data, 1, content->size, file);
+	re_file_close(file);
+}
+
+void bench_generate_corpus(const char* directory)
+{
+	cb_create_directories(directory, strlen(directory));
+
+	dstr content;
+	dstr_init(&content);
+
+	dstr main_content;
+	dstr_init(&main_content);
+
+	dstr filename;
+	dstr_init(&filename);
+
+	/* Deep include tree. */
+	for (int i = 0; i < BENCH_DEEP_DEPTH; i += 1)
+	{
+		dstr_assign_f(&content, "#ifndef DEEP_%d_H\n#define DEEP_%d_H\n", i, i);
+		if (i + 1 < BENCH_DEEP_DEPTH)
+		{
+			dstr_append_f(&content, "#include \"deep_%d.h\"\n", i + 1);
+		}
+		for (int j = 0; j < 20; j += 1)
+		{
+			dstr_append_f(&content, "extern int deep_%d_%d;\n", i, j);
+		}
+		dstr_append_f(&content, "#endif\n");
+
+		dstr_assign_f(&filename, "deep_%d.h", i);
+		bench_write_file(directory, filename.data, &content);
+	}
+	dstr_append_f(&main_content, "#include \"deep_0.h\"\n");
+
+	/* Guard-heavy headers. */
+	int layer_size = BENCH_GUARD_COUNT / BENCH_GUARD_LAYERS;
+	for (int i = 0; i < BENCH_GUARD_COUNT; i += 1)
+	{
+		int layer = i / layer_size;
+
+		dstr_assign_f(&content, "#ifndef GUARD_%d_H\n#define GUARD_%d_H\n", i, i);
+		for (int j = 0; layer > 0 && j < BENCH_GUARD_INCLUDES; j += 1)
+		{
+			int included = (layer - 1) * layer_size + (int)(bench_random() % layer_size);
+			dstr_append_f(&content, "#include \"guard_%d.h\"\n", included);
+		}
+		dstr_append_f(&content, "#define GUARD_%d_VALUE %u\n", i, bench_random() % 1000);
+		dstr_append_f(&content, "#define GUARD_%d_MAX(a, b) ((a) > (b) ? (a) : (b))\n", i);
+		dstr_append_f(&content, "struct guard_%d { int a; long b; char c[GUARD_%d_VALUE + 1]; };\n", i, i);
+		dstr_append_f(&content, "static int guard_%d_max = GUARD_%d_MAX(GUARD_%d_VALUE, %d);\n", i, i, i, i);
+		dstr_append_f(&content, "#if GUARD_%d_VALUE > 100000\n", i);
+		for (int j = 0; j < 10; j += 1)
+		{
+			dstr_append_f(&content, "static int guard_%d_never_%d = %d;\n", i, j, j);
+		}
+		dstr_append_f(&content, "#endif\n#endif\n");
+
+		dstr_assign_f(&filename, "guard_%d.h", i);
+		bench_write_file(directory, filename.data, &content);
+
+		dstr_append_f(&main_content, "#include \"guard_%d.h\"\n", i);
+	}
+
+	/* Macro-heavy X-table. */
+	{
+		dstr_assign_f(&content, "#define XTABLE \\\n");
+		for (int i = 0; i < BENCH_XTABLE_SIZE; i += 1)
+		{
+			dstr_append_f(&content, "    X(entry_%d, %u) \\\n", i, bench_random() % 100000);
+		}
+		dstr_append_f(&content, "\n");
+		dstr_append_f(&content, "#define X(name, value) name = value,\nenum xtable { XTABLE };\n#undef X\n");
+		dstr_append_f(&content, "#define X(name, value) #name,\nstatic const char* xtable_names[] = { XTABLE };\n#undef X\n");
+		dstr_append_f(&content, "#define X(name, value) case value: return #name;\nconst char* xtable_name(int v) { switch (v) { XTABLE } return 0; }\n#undef X\n");
+		dstr_append_f(&content, "#define X(name, value) + value\nstatic const long xtable_sum = 0 XTABLE;\n#undef X\n");
+
+		dstr_append_f(&content, "#define CHAIN_0 1\n");
+		for (int i = 1; i < BENCH_CHAIN_SIZE; i += 1)
+		{
+			dstr_append_f(&content, "#define CHAIN_%d (CHAIN_%d + %d)\n", i, i - 1, i);
+		}
+		dstr_append_f(&content, "static const long chain = CHAIN_%d;\n", BENCH_CHAIN_SIZE - 1);
+
+		bench_write_file(directory, "xtable.h", &content);
+		dstr_append_f(&main_content, "#include \"xtable.h\"\n");
+	}
+
+	/* Long comment blocks. */
+	{
+		dstr_assign_f(&content, "");
+		for (int i = 0; i < BENCH_COMMENT_BLOCKS; i += 1)
+		{
+			dstr_append_f(&content, "/*\n");
+			for (int j = 0; j < 10; j += 1)
+			{
+				dstr_append_f(&content, "    Comment %d line %d: lorem ipsum dolor sit amet, consectetur adipiscing elit %u.\n", i, j, bench_random());
+			}
+			dstr_append_f(&content, "*/\n// Line comment %d\nextern int commented_%d;\n", i, i);
+		}
+		bench_write_file(directory, "comments.h", &content);
+		dstr_append_f(&main_content, "#include \"comments.h\"\n");
+	}
+
+	/* Huge literal tables. */
+	{
+		dstr_assign_f(&content, "static const unsigned literal_integers[] = {\n");
+		for (int i = 0; i < BENCH_LITERAL_COUNT; i += 1)
+		{
+			uint32_t v = bench_random();
+			dstr_append_f(&content, (i % 3) ? "%uu," : "0x%Xu,", v);
+			if (i % 10 == 9) dstr_append_f(&content, "\n");
+		}
+		dstr_append_f(&content, "};\nstatic const double literal_floats[] = {\n");
+		for (int i = 0; i < BENCH_LITERAL_COUNT / 4; i += 1)
+		{
+			dstr_append_f(&content, "%u.%ue%d,", bench_random() % 1000, bench_random() % 1000, (int)(bench_random() % 20) - 10);
+			if (i % 10 == 9) dstr_append_f(&content, "\n");
+		}
+		dstr_append_f(&content, "};\nstatic const char* literal_strings[] = {\n");
+		for (int i = 0; i < BENCH_LITERAL_COUNT / 4; i += 1)
+		{
+			dstr_append_f(&content, "\"string_%u\\n\",", bench_random());
+			if (i % 10 == 9) dstr_append_f(&content, "\n");
+		}
+		dstr_append_f(&content, "};\n");
+		bench_write_file(directory, "literals.h", &content);
+		dstr_append_f(&main_content, "#include \"literals.h\"\n");
+	}
+
+	dstr_append_f(&main_content, "int main() { return 0; }\n");
+	bench_write_file(directory, "main.c", &main_content);
+
+	dstr_destroy(&content);
+	dstr_destroy(&main_content);
+	dstr_destroy(&filename);
+}
+
+/* Remove line markers and whitespaces so that outputs of different preprocessors can be compared. */
+void bench_normalize_output(dstr* result, const char* output)
+{
+	dstr_assign_f(result, "");
+
+	bool beginning_of_line = true;
+	for (const char* c = output; *c; c += 1)
+	{
+		if (beginning_of_line && *c == '#')
+		{
+			while (*c && *c != '\n') c += 1;
+			if (!*c) break;
+		}
+
+		beginning_of_line = *c == '\n';
+		if (!strchr(" \t\r\n\v\f", *c))
+		{
+			dstr_append_char(result, *c);
+		}
+	}
+}
+
+void bench_preprocessors(const char* ac_exe, const char* directory)
+{
+	assert_path(ac_exe);
+
+	const char* corpus_directory = cb_tmp_sprintf("%scorpus/", directory);
+	bench_generate_corpus(corpus_directory);
+
+	const char* main_file = cb_tmp_sprintf("%smain.c", corpus_directory);
+
+	bench_preprocessor preprocessors[] = {
+		{ "ac",    ac_exe,                        "--preprocess" },
+		{ "gcc",   bench_find_in_path("gcc"),     "-E -P" },
+		{ "clang", bench_find_in_path("clang"),   "-E -P" },
+		{ "tcc",   bench_find_in_path("tcc"),     "-E -P" },
+	};
+	size_t count = sizeof(preprocessors) / sizeof(preprocessors[0]);
+
+	dstr cmd;
+	dstr_init(&cmd);
+	dstr reference;
+	dstr_init(&reference);
+	dstr output;
+	dstr_init(&output);
+	dstr normalized;
+	dstr_init(&normalized);
+	dstr results;
+	dstr_init(&results);
+
+	for (size_t i = 0; i < count; i += 1)
+	{
+		bench_preprocessor* p = &preprocessors[i];
+		if (!p->exe)
+		{
+			continue;
+		}
+
+		/* The output is redirected by the shell into a file,
+		   cb_process_to_string only reads the pipe once the process has exited, which blocks on large outputs. */
+		const char* output_file = cb_tmp_sprintf("%s%s.i", directory, p->name);
+		dstr_assign_f(&cmd, "\"%s\" %s %s > %s", p->exe, p->arguments, main_file, output_file);
+		printf("Benchmarking: %s\n", cmd.data);
+
+		p->min_seconds = 0;
+		for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration += 1)
+		{
+			double start = bench_time_seconds();
+			int exit_code = system(cmd.data);
+			double seconds = bench_time_seconds() - start;
+
+			if (exit_code != 0)
+			{
+				fprintf(stderr, "'%s' did not exit with 0.\n", cmd.data);
+				exit(1);
+			}
+
+			if (iteration == 0 || seconds < p->min_seconds)
+			{
+				p->min_seconds = seconds;
+			}
+		}
+
+		if (!re_file_open_and_read(&output, output_file))
+		{
+			fprintf(stderr, "Can't open file: %s\n", output_file);
+			exit(1);
+		}
+		bench_normalize_output(&normalized, output.data);
+
+		/* ac is the first one, its output is the reference. */
+		if (i == 0)
+		{
+			dstr_assign(&reference, dstr_to_strv(&normalized));
+			p->output_status = "reference";
+		}
+		else
+		{
+			p->output_status = strv_equals(dstr_to_strv(&reference), dstr_to_strv(&normalized)) ? "same" : "different";
+		}
+	}
+
+	dstr_assign_f(&results, "| preprocessor | min time (ms) | relative to ac | output |\n");
+	dstr_append_f(&results, "|--------------|---------------|----------------|--------|\n");
+	for (size_t i = 0; i < count; i += 1)
+	{
+		bench_preprocessor* p = &preprocessors[i];
+		if (!p->exe)
+		{
+			dstr_append_f(&results, "| %s | - | - | not installed |\n", p->name);
+			continue;
+		}
+		dstr_append_f(&results, "| %s | %.2f | %.2fx | %s |\n",
+			p->name,
+			p->min_seconds * 1000.0,
+			p->min_seconds / preprocessors[0].min_seconds,
+			p->output_status);
+	}
+
+	bench_write_file(directory, "results.md", &results);
+	printf("\n%s\nResults written in %sresults.md\n", results.data, directory);
+
+	dstr_destroy(&cmd);
+	dstr_destroy(&reference);
+	dstr_destroy(&output);
+	dstr_destroy(&normalized);
+	dstr_destroy(&results);
+}
+
 #define STRV_IMPLEMENTATION
 #include "src/external/re.lib/c/re/strv.h"
 #include "src/external/re.lib/c/re/strv_extensions.h"
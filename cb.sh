@@ -14,6 +14,7 @@ while (( "$#" )); do
     if [ "$1" == "gcc" ];    then cb_gcc=1;   cb_compiler="${CC:-gcc}";   unset cb_clang; fi
     if [ "$1" == "help" ];   then cb_help=1; fi
     if [ "$1" == "run" ];    then cb_run=1; fi
+    if [ "$1" == "bench" ];  then cb_run_args="bench"; fi
     if [ "$1" == "--pedantic" ]; then cb_pedantic=1; fi
     if [ "$1" == "--file" ]; then cb_file=$2; shift; fi
     if [ "$1" == "--output" ]; then cb_output=$2; shift; fi 
@@ -49,5 +50,5 @@ fi
 
 # Check if there is a value in cb_run.
 if [ -v cb_run ]; then
-   "$cb_output" || { echo "'$cb_output' exited with $?"; exit 1; }
+   "$cb_output" $cb_run_args || { echo "'$cb_output' exited with $?"; exit 1; }
 fi
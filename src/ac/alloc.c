@@ -1,5 +1,13 @@
 #include "alloc.h"
 
+#include "stats.h"
+
+static AC_THREAD_LOCAL ac_malloc_traffic traffics[ac_malloc_source_COUNT];
+
+static AC_THREAD_LOCAL ac_allocator_arena scratch_arena;
+static AC_THREAD_LOCAL bool scratch_arena_initialized;
+
+static re_arena* scratch(void);
 static void* ac_default_malloc(ac_handle handle, void* old, size_t size);
 static void  ac_default_free(ac_handle handle, void* ptr);
 static void* ac_arena_malloc(ac_handle handle, void* old, size_t size);
@@ -36,6 +44,24 @@ ac_allocator_arena_init(ac_allocator_arena* a, size_t check_min_capacity)
     ac_allocator_init(&a->allocator, ac_arena_malloc, ac_arena_free, h);
 }
 
+void
+ac_allocator_arena_init_kind(ac_allocator_arena* a, enum ac_arena_kind kind, size_t reserve_size)
+{
+    if (kind == ac_arena_kind_CHUNKS)
+    {
+        ac_allocator_arena_init(a, 16 * 1024);
+        return;
+    }
+
+    /* Commit 1 MiB at a time, or a whole huge page, pages are only backed once touched.
+       Once the range is full, or if it could not be reserved, the arena uses chunks of the same size. */
+    bool huge_pages = kind == ac_arena_kind_HUGE_PAGES;
+    re_arena_init_virtual(&a->arena, reserve_size, huge_pages ? 2 * 1024 * 1024 : 1024 * 1024, huge_pages);
+    ac_handle h;
+    h.ptr = a;
+    ac_allocator_init(&a->allocator, ac_arena_malloc, ac_arena_free, h);
+}
+
 void
 ac_allocator_arena_destroy(ac_allocator_arena* a)
 {
@@ -59,6 +85,112 @@ ac_allocator_free(ac_allocator* a, void* ptr)
     a->free(a->user_data, ptr);
 }
 
+void*
+ac_allocator_arena_allocate_bytes(ac_allocator_arena* a, size_t byte_size)
+{
+    void* ptr = re_arena_alloc(&a->arena, byte_size);
+    AC_ASSERT(ptr && "Could not allocate memory.");
+    return ptr;
+}
+
+void*
+ac_allocator_arena_allocate_aligned(ac_allocator_arena* a, size_t byte_size, size_t alignment)
+{
+    void* ptr = re_arena_alloc_aligned(&a->arena, byte_size, alignment);
+    AC_ASSERT(ptr && "Could not allocate memory.");
+    return ptr;
+}
+
+void
+ac_allocator_arena_usage(ac_allocator_arena* a, size_t* used, size_t* reserved, size_t* chunk_count)
+{
+    *used = 0;
+    *reserved = 0;
+    *chunk_count = 0;
+
+    for (re_chunk* c = a->arena.first; c; c = c->next)
+    {
+        *used += c->size;
+        *reserved += c->capacity;
+        *chunk_count += 1;
+    }
+}
+
+ac_scratch
+ac_scratch_begin(void)
+{
+    ac_scratch s;
+    s.mark = re_arena_get_mark(scratch());
+    return s;
+}
+
+void
+ac_scratch_end(ac_scratch s)
+{
+    re_arena_rewind(scratch(), s.mark);
+}
+
+void
+ac_scratch_release(void)
+{
+    if (scratch_arena_initialized)
+    {
+        ac_allocator_arena_destroy(&scratch_arena);
+        scratch_arena_initialized = false;
+    }
+}
+
+void
+ac_scratch_grow_array(void** data, size_t* capacity, size_t item_size)
+{
+    size_t new_capacity = *capacity ? *capacity * 2 : 16;
+    *data = re_arena_grow(scratch(), *data, *capacity * item_size, new_capacity * item_size, sizeof(void*));
+    AC_ASSERT(*data && "Could not allocate memory.");
+    *capacity = new_capacity;
+}
+
+void*
+ac_counted_malloc(enum ac_malloc_source source, size_t byte_size)
+{
+    traffics[source].allocation_count += 1;
+    traffics[source].allocated_bytes += byte_size;
+
+    if (source == ac_malloc_source_DARR)
+        AC_STATS_ADD(darr_allocation_count, 1);
+    else if (source == ac_malloc_source_DSTR)
+        AC_STATS_ADD(dstr_allocation_count, 1);
+
+    return malloc(byte_size);
+}
+
+void
+ac_counted_free(enum ac_malloc_source source, void* ptr)
+{
+    if (ptr)
+    {
+        traffics[source].free_count += 1;
+    }
+    free(ptr);
+}
+
+ac_malloc_traffic
+ac_malloc_traffic_of(enum ac_malloc_source source)
+{
+    return traffics[source];
+}
+
+static re_arena*
+scratch(void)
+{
+    if (!scratch_arena_initialized)
+    {
+        /* Scopes are short, the range is only touched as deep as the deepest scope. */
+        ac_allocator_arena_init_kind(&scratch_arena, ac_arena_kind_VIRTUAL, (size_t)256 << 20);
+        scratch_arena_initialized = true;
+    }
+    return &scratch_arena.arena;
+}
+
 static void*
 ac_default_malloc(ac_handle handle, void* old, size_t size)
 {
@@ -30,12 +30,121 @@ void ac_allocator_init(ac_allocator* a, ac_malloc malloc, ac_free free, ac_handl
 void ac_allocator_init_with_default(ac_allocator* a);
 void ac_allocator_destroy(ac_allocator* a);
 
+/* How the memory of an arena is obtained. */
+enum ac_arena_kind {
+    ac_arena_kind_VIRTUAL,    /* Reserve a range of addresses once and commit it progressively. */
+    ac_arena_kind_HUGE_PAGES, /* Same as VIRTUAL, the range uses transparent huge pages when possible. */
+    ac_arena_kind_CHUNKS,     /* Chunks allocated with malloc. */
+};
+
 void ac_allocator_arena_init(ac_allocator_arena* a, size_t check_min_capacity);
+/* Init an arena of the given kind, 'reserve_size' is the size of the range of the virtual kinds.
+   Memory that does not fit in the range is taken from chunks like any other arena. */
+void ac_allocator_arena_init_kind(ac_allocator_arena* a, enum ac_arena_kind kind, size_t reserve_size);
 void ac_allocator_arena_destroy(ac_allocator_arena* a);
 
 void* ac_allocator_allocate(ac_allocator* a, size_t byte_size);
 void ac_allocator_free(ac_allocator* a, void *ptr);
 
+/* Allocate directly from the arena, the memory is not zeroed.
+   Bytes are not aligned, they are meant for text that is packed one string after the other. */
+void* ac_allocator_arena_allocate_bytes(ac_allocator_arena* a, size_t byte_size);
+void* ac_allocator_arena_allocate_aligned(ac_allocator_arena* a, size_t byte_size, size_t alignment);
+
+/*
+    Typed allocation from an arena, for the nodes allocated on hot paths.
+    The pointer bump is inlined, the allocator is only called when the current chunk is full.
+    ac_arena_new does not zero the memory, the node must be fully initialized by the caller.
+    ac_arena_new_zero only clears memory that was used before, the reserved range of a virtual arena
+    is zero when it is committed.
+*/
+#define ac_arena_new(a, type) ((type*)ac_arena_push((a), sizeof(type), AC_ALIGNOF(type)))
+#define ac_arena_new_zero(a, type) ((type*)ac_arena_push_zero((a), sizeof(type), AC_ALIGNOF(type)))
+
+static inline void*
+ac_arena_push(ac_allocator_arena* a, size_t byte_size, size_t alignment)
+{
+    re_chunk* c = a->arena.last;
+    if (c)
+    {
+        size_t current = (size_t)((char*)c + c->size);
+        size_t padding = ((current + alignment - 1) & ~(alignment - 1)) - current;
+        if (c->size + padding + byte_size <= c->capacity)
+        {
+            c->size += padding + byte_size;
+            return (char*)(current + padding);
+        }
+    }
+    return ac_allocator_arena_allocate_aligned(a, byte_size, alignment);
+}
+
+static inline void*
+ac_arena_push_zero(ac_allocator_arena* a, size_t byte_size, size_t alignment)
+{
+    char* ptr = (char*)ac_arena_push(a, byte_size, alignment);
+    re_arena* r = &a->arena;
+    bool never_used = r->reserved_size
+        && ptr >= (char*)r->first + r->touched_size
+        && ptr < (char*)r->first + r->first->capacity;
+    if (!never_used)
+    {
+        memset(ptr, 0, byte_size);
+    }
+    return ptr;
+}
+
+/* Memory used and reserved by the chunks of the arena. */
+void ac_allocator_arena_usage(ac_allocator_arena* a, size_t* used, size_t* reserved, size_t* chunk_count);
+
+/*
+    Scratch memory of the current thread for the buffers that don't outlive a directive or a macro expansion.
+    A scope saves the top of the scratch arena and ac_scratch_end gives back everything allocated since,
+    scopes must end in the reverse order they began. Memory is not zeroed.
+*/
+typedef struct ac_scratch ac_scratch;
+struct ac_scratch {
+    re_arena_mark mark;
+};
+
+ac_scratch ac_scratch_begin(void);
+void ac_scratch_end(ac_scratch s);
+/* Release the scratch memory of the current thread, it is reserved again on the next use. */
+void ac_scratch_release(void);
+
+/* Array in the scratch memory. It grows in place while it is the last scratch allocation,
+   it is moved otherwise, the previous memory is given back when the scope ends. */
+#define ac_scratch_arrayT(type) struct { type* data; size_t size; size_t capacity; }
+
+#define ac_scratch_array_init(arr) \
+    ((arr)->data = NULL, (arr)->size = 0, (arr)->capacity = 0)
+
+#define ac_scratch_array_push_back(arr, value) \
+    (((arr)->size == (arr)->capacity ? ac_scratch_grow_array((void**)&(arr)->data, &(arr)->capacity, sizeof(*(arr)->data)) : (void)0), \
+    (arr)->data[(arr)->size++] = (value))
+
+void ac_scratch_grow_array(void** data, size_t* capacity, size_t item_size);
+
+/* Libraries whose allocations are counted. */
+enum ac_malloc_source {
+    ac_malloc_source_DARR,
+    ac_malloc_source_DSTR,
+    ac_malloc_source_HT,
+    ac_malloc_source_ARENA,
+    ac_malloc_source_COUNT,
+};
+
+typedef struct ac_malloc_traffic ac_malloc_traffic;
+struct ac_malloc_traffic {
+    size_t allocation_count;
+    size_t allocated_bytes;
+    size_t free_count;
+};
+
+/* malloc and free used by re.lib, they count the traffic of the current thread. */
+void* ac_counted_malloc(enum ac_malloc_source source, size_t byte_size);
+void ac_counted_free(enum ac_malloc_source source, void* ptr);
+ac_malloc_traffic ac_malloc_traffic_of(enum ac_malloc_source source);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
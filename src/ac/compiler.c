@@ -5,8 +5,28 @@
 #include "global.h"
 #include "parser_c.h"
 #include "converter_c.h"
+#include "pch.h"
+#include "stats.h"
+#include "thread_pool.h"
+#include "trace.h"
 
 static ac_options* options(ac_compiler* c);
+/* The memory report is printed in 'report' if it's not NULL, before the memory of the preprocessors is released. */
+static bool compile_file(ac_manager* m, const char* source_filepath, FILE* output, FILE* report);
+/* Print the memory report of the manager if 'report' is not NULL. */
+static void print_memory_report(ac_manager* m, FILE* report);
+
+/* Compile all files on the thread pool, then print their output and diagnostics in the order of the files. */
+static bool compile_units(ac_compiler* c);
+static void compile_unit(ac_compiler* c, size_t unit_index); /* Task of the thread pool. */
+/* Copy the content of a temporary file and close it. */
+static void flush_temporary_file(FILE* tmp, FILE* file);
+
+/* Print the files loaded by the manager as a make rule like "gcc -M". */
+static void print_make_dependencies(ac_manager* m, FILE* file, strv source_filepath);
+/* Print the files loaded by the manager as a JSON object. */
+static void print_json_dependencies(ac_manager* m, FILE* file, strv source_filepath);
+static void print_escaped(FILE* file, strv text, const char* escaped_chars);
 
 void ac_compiler_init(ac_compiler* c, ac_options* options)
 {
@@ -19,79 +39,293 @@ void ac_compiler_init(ac_compiler* c, ac_options* options)
 
 void ac_compiler_destroy(ac_compiler* c)
 {
+    for (size_t i = 0; i < c->unit_count; i += 1)
+    {
+        ac_manager_destroy(&c->units[i].mgr);
+    }
+    free(c->units);
+
+    if (c->shared_strings)
+    {
+        ac_intern_table_destroy(c->shared_strings);
+        free(c->shared_strings);
+    }
+
     ac_manager_destroy(&c->mgr);
+
+    /* Scratch memory of the main thread, the other threads release theirs when they end. */
+    ac_scratch_release();
 }
 
 bool ac_compiler_compile(ac_compiler* c)
 {
     AC_ASSERT(darrT_size(&(options(c)->files)));
-    AC_ASSERT(darrT_size(&(options(c)->files)) == 1 && "Not supported yet. Cannot compile multiple files.");
-    
-    if (darrT_size(&(options(c)->files)) > 1)
+
+    if (options(c)->trace)
+    {
+        ac_trace_start();
+    }
+
+    uint64_t start_ns = ac_trace_begin();
+    bool result;
+    if (darrT_size(&(options(c)->files)) == 1)
+    {
+        FILE* report = options(c)->memory_report ? stderr : NULL;
+        result = compile_file(&c->mgr, darrT_at(&options(c)->files, 0), stdout, report);
+    }
+    else
+    {
+        result = compile_units(c);
+    }
+    ac_trace_end(start_ns, "compiler", strv_make_from_str("compile"));
+
+    if (options(c)->trace)
+    {
+        /* Spans refer to names owned by the managers, they are written before the managers are destroyed. */
+        result = ac_trace_write(options(c)->trace) && result;
+        ac_trace_stop();
+    }
+
+    if (options(c)->stats)
+    {
+        ac_stats_merge();
+        ac_stats_print(stderr);
+    }
+
+    return result;
+}
+
+static bool compile_units(ac_compiler* c)
+{
+    if (options(c)->emit_pch || options(c)->profile_preprocessor)
     {
-        ac_report_internal_error("cannot compile multiple files: not yet supported");
+        ac_report_error("cannot use --emit-pch or --profile-preprocessor with multiple files");
         return false;
     }
 
-    /* @FIXME we only get the first file since compiling multiple files is not yet supported. */
-    char* source_filepath = (char*)darrT_at(&options(c)->files, 0);
+    c->unit_count = darrT_size(&(options(c)->files));
+    c->units = malloc(sizeof(ac_compiler_unit) * c->unit_count);
+    c->shared_strings = malloc(sizeof(ac_intern_table));
+    ac_intern_table_init(c->shared_strings);
+
+    /* Managers are initialized on this thread, the options are only read by the workers afterward. */
+    for (size_t i = 0; i < c->unit_count; i += 1)
+    {
+        ac_compiler_unit* u = &c->units[i];
+        ac_manager_init(&u->mgr, options(c));
+        u->mgr.shared_strings = c->shared_strings;
+        u->filepath = darrT_at(&options(c)->files, i);
+        u->output = tmpfile();
+        u->diagnostics = tmpfile();
+        u->result = false;
+    }
+
+    size_t thread_count = options(c)->jobs ? options(c)->jobs : ac_thread_count();
+    ac_thread_pool_run(thread_count, c->unit_count, (ac_task_function)compile_unit, c);
+
+    bool result = true;
+    for (size_t i = 0; i < c->unit_count; i += 1)
+    {
+        ac_compiler_unit* u = &c->units[i];
+        flush_temporary_file(u->diagnostics, stderr);
+        flush_temporary_file(u->output, stdout);
+        result = u->result && result;
+    }
+    return result;
+}
+
+static void compile_unit(ac_compiler* c, size_t unit_index)
+{
+    ac_compiler_unit* u = &c->units[unit_index];
+
+    if (!u->output || !u->diagnostics)
+    {
+        ac_report_error("could not create temporary files to compile '%s'", u->filepath);
+        return;
+    }
+
+    if (options(c)->trace)
+    {
+        ac_trace_start();
+    }
+
+    global_options = options(c)->global;
+    ac_set_report_file(u->diagnostics);
+
+    FILE* report = NULL;
+    if (options(c)->memory_report)
+    {
+        /* The report is printed during the compilation, the name of the file comes first. */
+        fprintf(u->diagnostics, "%s:\n", u->filepath);
+        report = u->diagnostics;
+    }
+
+    u->result = compile_file(&u->mgr, u->filepath, u->output, report);
+
+    ac_set_report_file(NULL);
+
+    ac_stats_merge();
+}
+
+static void flush_temporary_file(FILE* tmp, FILE* file)
+{
+    if (!tmp)
+    {
+        return;
+    }
+
+    char buffer[4096];
+    size_t size;
+    rewind(tmp);
+    while ((size = fread(buffer, 1, sizeof(buffer), tmp)) > 0)
+    {
+        fwrite(buffer, 1, size, file);
+    }
+    fclose(tmp);
+}
 
+static bool compile_file(ac_manager* m, const char* source_filepath, FILE* output, FILE* report)
+{
     /* Load file into memory. */
     ac_source_file src_file;
-    if (!ac_manager_load_content(&c->mgr, source_filepath, &src_file))
+    uint64_t start_ns = ac_trace_begin();
+    bool loaded = ac_manager_load_content(m, (char*)source_filepath, &src_file);
+    ac_trace_end(start_ns, "compiler", strv_make_from_str("load"));
+    if (!loaded)
     {
+        print_memory_report(m, report);
         return false;
     }
 
+    /* Only the size of the main file is known before preprocessing, the tables can still grow with the included files. */
+    ac_manager_reserve_for_input(m, src_file.content.size);
+
+    /*** Precompiled header ***/
+    if (m->options->emit_pch)
+    {
+        ac_pp pp;
+        ac_pp_init(&pp, m, src_file.content, src_file.filepath);
+
+        /* Tokens of the prelude, they are replayed by the files using the precompiled header. */
+        darrT(ac_token) output;
+        darrT_init(&output);
+
+        start_ns = ac_trace_begin();
+        ac_token* t;
+        while ((t = ac_pp_goto_next(&pp))->type != ac_token_type_EOF)
+        {
+            darrT_push_back(&output, *t);
+        }
+        ac_trace_end(start_ns, "compiler", strv_make_from_str("preprocess"));
+
+        bool result = !t->is_premature_eof
+            && ac_pch_save(&pp, m->options->emit_pch, darrT_ptr(&output, 0), darrT_size(&output));
+        result = ac_pp_report_profile(&pp) && result;
+
+        darrT_destroy(&output);
+        ac_pp_destroy(&pp);
+        print_memory_report(m, report);
+        return result;
+    }
+
+    /*** Dependency scanning ***/
+    if (m->options->scan_deps)
+    {
+        ac_pp pp;
+        ac_pp_init(&pp, m, src_file.content, src_file.filepath);
+
+        start_ns = ac_trace_begin();
+        ac_token* t;
+        while ((t = ac_pp_goto_next(&pp))->type != ac_token_type_EOF)
+        {
+        }
+        ac_trace_end(start_ns, "compiler", strv_make_from_str("preprocess"));
+
+        bool result = !t->is_premature_eof;
+        if (result)
+        {
+            if (m->options->deps_format == ac_deps_format_JSON)
+                print_json_dependencies(m, output, src_file.filepath);
+            else
+                print_make_dependencies(m, output, src_file.filepath);
+        }
+        result = ac_pp_report_profile(&pp) && result;
+
+        ac_pp_destroy(&pp);
+        print_memory_report(m, report);
+        return result;
+    }
+
     /*** Preprocess only ***/
-    if (options(c)->preprocess || options(c)->preprocess_benchmark)
+    if (m->options->preprocess || m->options->preprocess_benchmark)
     {
         ac_pp pp;
-        ac_pp_init(&pp, &c->mgr, src_file.content, src_file.filepath);
+        ac_pp_init(&pp, m, src_file.content, src_file.filepath);
 
-        if (options(c)->preprocess)
-            ac_pp_preprocess(&pp, stdout);
+        start_ns = ac_trace_begin();
+        if (m->options->preprocess)
+            ac_pp_preprocess(&pp, output);
         else
-            ac_pp_preprocess_benchmark(&pp, stdout);
+            ac_pp_preprocess_benchmark(&pp, output);
+        ac_trace_end(start_ns, "compiler", strv_make_from_str("preprocess"));
+
+        bool result = ac_pp_report_profile(&pp);
 
         ac_pp_destroy(&pp);
-        return true;
+        print_memory_report(m, report);
+        return result;
     }
     
     /*** Parsing ***/
 
     ac_parser_c parser;
-    ac_parser_c_init(&parser, &c->mgr, src_file.content, src_file.filepath);
+    ac_parser_c_init(&parser, m, src_file.content, src_file.filepath);
+
+    /* Preprocessing is done lazily by the parser, it's part of this span. */
+    start_ns = ac_trace_begin();
+    bool parsed = ac_parser_c_parse(&parser);
+    ac_trace_end(start_ns, "compiler", strv_make_from_str("parse"));
+    bool reported = ac_pp_report_profile(&parser.pp);
+    ac_parser_c_destroy(&parser);
+
+    /* Only the AST is needed from now on, the memory of the preprocessing is not kept until the code is generated. */
+    print_memory_report(m, report);
+    ac_manager_release_preprocessor_memory(m);
+    ac_scratch_release();
 
-    if (!ac_parser_c_parse(&parser))
+    if (!parsed || !reported)
     {
-        ac_parser_c_destroy(&parser);
         return false;
     }
-    ac_parser_c_destroy(&parser);
 
     /*** Type/semantic check - @TODO ***/
 
-    if ((options(c)->step & ac_compilation_step_SEMANTIC) == 0)
+    if ((m->options->step & ac_compilation_step_SEMANTIC) == 0)
     {
         return true;
     }
+
+    /* Empty span until there is a semantic check, it keeps the phases of the timeline stable. */
+    start_ns = ac_trace_begin();
+    ac_trace_end(start_ns, "compiler", strv_make_from_str("semantic"));
     
     /*** Generate ***/
 
-    if ((options(c)->step & ac_compilation_step_GENERATE) == 0)
+    if ((m->options->step & ac_compilation_step_GENERATE) == 0)
     {
         return true;
     }
 
+    start_ns = ac_trace_begin();
+
     ac_converter_c conv;
 
-    ac_converter_c_init(&conv, &c->mgr);
+    ac_converter_c_init(&conv, m);
 
     dstr output_file;
     dstr_init(&output_file);
     dstr_assign_str(&output_file, source_filepath);
-    re_path_replace_extension(&output_file, options(c)->output_extension);
+    re_path_replace_extension(&output_file, m->options->output_extension);
 
     ac_converter_c_convert(&conv, output_file.data);
 
@@ -99,10 +333,65 @@ bool ac_compiler_compile(ac_compiler* c)
 
     dstr_destroy(&output_file);
 
+    ac_trace_end(start_ns, "compiler", strv_make_from_str("generate"));
+
     return true;
 }
 
+
+static void print_memory_report(ac_manager* m, FILE* report)
+{
+    if (report)
+    {
+        ac_manager_print_memory_report(m, report);
+    }
+}
+
 static ac_options* options(ac_compiler* c)
 {
     return c->mgr.options;
-}
\ No newline at end of file
+}
+
+static void print_make_dependencies(ac_manager* m, FILE* file, strv source_filepath)
+{
+    /* The target is the object file of the source, in the current directory. */
+    strv basename = re_path_basename(source_filepath);
+    print_escaped(file, basename, " #$");
+    fprintf(file, ".o:");
+
+    for (size_t i = 0; i < ac_manager_loaded_file_count(m); i += 1)
+    {
+        fprintf(file, " \\\n  ");
+        print_escaped(file, ac_manager_loaded_filepath(m, i), " #$");
+    }
+    fprintf(file, "\n");
+}
+
+static void print_json_dependencies(ac_manager* m, FILE* file, strv source_filepath)
+{
+    fprintf(file, "{\n  \"file\": \"");
+    print_escaped(file, source_filepath, "\"\\");
+    fprintf(file, "\",\n  \"dependencies\": [");
+
+    for (size_t i = 0; i < ac_manager_loaded_file_count(m); i += 1)
+    {
+        fprintf(file, i ? ",\n    \"" : "\n    \"");
+        print_escaped(file, ac_manager_loaded_filepath(m, i), "\"\\");
+        fprintf(file, "\"");
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+static void print_escaped(FILE* file, strv text, const char* escaped_chars)
+{
+    for (size_t i = 0; i < text.size; i += 1)
+    {
+        char c = text.data[i];
+        if (strchr(escaped_chars, c))
+        {
+            /* Make escapes '$' by doubling it. */
+            fputc(c == '$' ? '$' : '\\', file);
+        }
+        fputc(c, file);
+    }
+}
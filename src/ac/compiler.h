@@ -7,9 +7,22 @@
 extern "C" {
 #endif
 
+/* Translation unit compiled by a thread of the pool when there are multiple files. */
+typedef struct ac_compiler_unit ac_compiler_unit;
+struct ac_compiler_unit {
+    ac_manager mgr;
+    const char* filepath;
+    FILE* output;      /* Output of the preprocessor or the dependency scanning, printed once all units are compiled. */
+    FILE* diagnostics; /* Errors and warnings, printed once all units are compiled. */
+    bool result;
+};
+
 typedef struct ac_compiler ac_compiler;
 struct ac_compiler {
     ac_manager mgr;
+    ac_compiler_unit* units;
+    size_t unit_count;
+    ac_intern_table* shared_strings; /* Identifiers and literals shared by the units. */
 };
 
 void ac_compiler_init(ac_compiler* c, ac_options* o);
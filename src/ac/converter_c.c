@@ -8,7 +8,12 @@
 
 #define CAST_TO(type_, ident_, object_) type_ ident_ = (type_)(object_)
 
-static void print_top_level(ac_converter_c* c);
+enum {
+    OUTPUT_FLUSH_SIZE = 64 * 1024, /* The printed text is written to the file once it reaches this size. */
+};
+
+/* Print the top level declarations, the output is written to 'f' by parts of about OUTPUT_FLUSH_SIZE bytes. */
+static void print_top_level(ac_converter_c* c, FILE* f);
 static void print_expr(ac_converter_c* c, ac_ast_expr* expr);
 static void print_identifier(ac_converter_c* c, ac_ast_identifier* identifier);
 static void print_type_specifier(ac_converter_c* c, ac_ast_type_specifier* type_specifier);
@@ -51,14 +56,13 @@ void ac_converter_c_destroy(ac_converter_c* c)
 
 void ac_converter_c_convert(ac_converter_c* c, const char* filepath)
 {
-    print_top_level(c);
-
     FILE* f = re_file_open_readwrite(filepath);
+    print_top_level(c, f);
     write_to_file(dstr_to_strv(&c->string_buffer), f);
     re_file_close(f);
 }
 
-static void print_top_level(ac_converter_c* c)
+static void print_top_level(ac_converter_c* c, FILE* f)
 {
     ac_ast_top_level* top_level = c->mgr->top_level;
 
@@ -66,6 +70,13 @@ static void print_top_level(ac_converter_c* c)
     for(EACH_EXPR(current, top_level->block.statements))
     {
         print_expr(c, current);
+
+        /* The whole generated file is never held in memory. */
+        if (c->string_buffer.size >= OUTPUT_FLUSH_SIZE)
+        {
+            write_to_file(dstr_to_strv(&c->string_buffer), f);
+            dstr_clear(&c->string_buffer);
+        }
     }
 }
 
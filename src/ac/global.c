@@ -2,11 +2,24 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h> /* memcpy */
+
+#if _WIN32
+#include <intrin.h> /* _umul128 */
+#include <psapi.h>  /* GetProcessMemoryInfo */
+#else
+#include <time.h>         /* clock_gettime */
+#include <sys/resource.h> /* getrusage */
+#endif
 
 #include "internal.h"
 #include "ast.h"
+#include "thread_pool.h" /* ac_mutex */
+
+AC_THREAD_LOCAL global_options_t global_options;
 
-global_options_t global_options;
+/* Diagnostics of the current thread are written to this file, stderr if NULL. */
+static AC_THREAD_LOCAL FILE* current_report_file;
 
 enum message_type
 {
@@ -20,6 +33,8 @@ enum message_type
     message_type_PP_ERROR,
 };
 
+/* Internal errors exit the process, they are always written to stderr to not be lost. */
+static FILE* report_file(enum message_type type);
 static void display_message_v(FILE* file, enum message_type type, ac_location location, int surrounding_lines, const char* fmt, va_list args);
 static const char* get_message_prefix(enum message_type type);
 
@@ -32,7 +47,7 @@ static void print_underline_cursor(FILE* file, strv line, size_t pos);
         va_start(args, fmt); \
         ac_location empty_location = ac_location_empty(); \
         int no_surrounding_lines = 0; \
-        display_message_v(stderr, message_type, empty_location, no_surrounding_lines, fmt, args); \
+        display_message_v(report_file(message_type), message_type, empty_location, no_surrounding_lines, fmt, args); \
         va_end(args); \
     } while (0)
     
@@ -40,7 +55,7 @@ static void print_underline_cursor(FILE* file, strv line, size_t pos);
     do { \
         va_list args; \
         va_start(args, fmt); \
-        display_message_v(stderr, message_type, loc, global_options.display_surrounding_lines, fmt, args); \
+        display_message_v(report_file(message_type), message_type, loc, global_options.display_surrounding_lines, fmt, args); \
         va_end(args); \
     } while (0)
 
@@ -48,18 +63,21 @@ static void print_underline_cursor(FILE* file, strv line, size_t pos);
 #define MAX_PATH 4096
 #endif
 
+/* Guards the default include directory and the include directories of the options,
+   which can be shared by managers initialized on different threads. */
+static ac_mutex default_system_include_lock = AC_MUTEX_INITIALIZER;
 static char default_system_include[MAX_PATH];
 
+static bool path_array_contains(path_array* items, strv path);
+
 void ac_add_default_system_includes(path_array* items)
 {
-    if (default_system_include[0] != 0)
-    {
-        ac_report_internal_error("default system includes already added");
-    }
+    ac_mutex_lock(&default_system_include_lock);
 
-    /* Retrieve default system include path.
+    /* Retrieve default system include path only once.
        By default, the include/ folder is located next to the binary.
        @TODO: Implement a way to customize it. */
+    if (default_system_include[0] == 0)
     {
 #if _WIN32
         GetModuleFileNameA(NULL, default_system_include, MAX_PATH);
@@ -69,6 +87,7 @@ void ac_add_default_system_includes(path_array* items)
 
         if (len == -1)
         {
+            ac_mutex_unlock(&default_system_include_lock);
             ac_report_internal_error("could not get assembly directory");
             return;
         }
@@ -82,6 +101,7 @@ void ac_add_default_system_includes(path_array* items)
 
         if (remaining < strlen("include"))
         {
+            ac_mutex_unlock(&default_system_include_lock);
             ac_report_internal_error("default include path too long.");
             return;
         }
@@ -90,13 +110,38 @@ void ac_add_default_system_includes(path_array* items)
         snprintf(p, remaining, "include");
     }
 
-    darrT_push_back(items, strv_make_from_str(default_system_include));
+    /* The same options can be used by multiple managers, avoid adding the same directories again. */
+    strv defaults[] = {
+        strv_make_from_str(default_system_include),
 #if _WIN32
-   /* @TODO create and include Windows only headers here. */
+        /* @TODO create and include Windows only headers here. */
 #else
-    darrT_push_back(items, strv_make_from_str("/usr/local/include"));
-    darrT_push_back(items, strv_make_from_str("/usr/include"));
+        STRV("/usr/local/include"),
+        STRV("/usr/include"),
 #endif
+    };
+
+    for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i += 1)
+    {
+        if (!path_array_contains(items, defaults[i]))
+        {
+            darrT_push_back(items, defaults[i]);
+        }
+    }
+
+    ac_mutex_unlock(&default_system_include_lock);
+}
+
+static bool path_array_contains(path_array* items, strv path)
+{
+    for (size_t i = 0; i < darrT_size(items); i += 1)
+    {
+        if (strv_equals(darrT_at(items, i), path))
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 void ac_report_warning(const char* fmt, ...)
@@ -147,7 +192,7 @@ void ac_report_error_expr(ac_ast_expr* expr, const char* fmt, ...)
     va_start(args, fmt);
 
     ac_location loc = ac_ast_expr_location(expr);
-    display_message_v(stderr, message_type_ERROR, loc, global_options.display_surrounding_lines, fmt, args);
+    display_message_v(report_file(message_type_ERROR), message_type_ERROR, loc, global_options.display_surrounding_lines, fmt, args);
 
     va_end(args);
 }
@@ -158,7 +203,7 @@ void ac_report_warning_expr(ac_ast_expr* expr, const char* fmt, ...)
     va_start(args, fmt);
 
     ac_location loc = ac_ast_expr_location(expr);
-    display_message_v(stderr, message_type_WARNING, loc, global_options.display_surrounding_lines, fmt, args);
+    display_message_v(report_file(message_type_WARNING), message_type_WARNING, loc, global_options.display_surrounding_lines, fmt, args);
 
     va_end(args);
 }
@@ -234,6 +279,15 @@ static void display_message_v(FILE* file, enum message_type type, ac_location lo
     dstr256_destroy(&message);
 }
 
+static FILE* report_file(enum message_type type)
+{
+    if (type == message_type_INTERNAL_ERROR || !current_report_file)
+    {
+        return stderr;
+    }
+    return current_report_file;
+}
+
 static const char* get_message_prefix(enum message_type type)
 {
     switch (type)
@@ -271,15 +325,142 @@ static void print_underline_cursor(FILE* file, strv line, size_t pos)
     printf("^");
 }
 
-size_t ac_hash(char* str, size_t count)
+void ac_set_report_file(FILE* file)
+{
+    current_report_file = file;
+}
+
+/* Constants of the hash, odd numbers with half of the bits set. */
+#define HASH_SECRET_0 0xa0761d6478bd642full
+#define HASH_SECRET_1 0xe7037ed1a0b428dbull
+
+static inline uint64_t hash_read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hash_read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* 128-bit product of 'a' and 'b', the low half is stored in 'a', the high half in 'b'. */
+static inline void hash_multiply(uint64_t* a, uint64_t* b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *a = _umul128(*a, *b, b);
+#else
+    uint64_t a_high = *a >> 32, a_low = (uint32_t)*a;
+    uint64_t b_high = *b >> 32, b_low = (uint32_t)*b;
+    uint64_t high_high = a_high * b_high, high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high, low_low = a_low * b_low;
+    uint64_t cross = (low_low >> 32) + (uint32_t)high_low + low_high;
+    *a = (cross << 32) | (uint32_t)low_low;
+    *b = high_high + (high_low >> 32) + (cross >> 32);
+#endif
+}
+
+/* Multiply and fold the two halves of the product, every bit of the inputs affects every bit of the result. */
+static inline uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    hash_multiply(&a, &b);
+    return a ^ b;
+}
+
+size_t ac_hash(char* str, size_t size)
 {
-    size_t hash = AC_HASH_INIT;
-    size_t i = 0;
-    while (i < count)
+    /* wyhash-like: bytes are read 4 or 8 at a time, each 16 bytes are folded with a single multiplication.
+       Identifiers are mostly shorter than 16 bytes and are hashed with two multiplications. */
+    const unsigned char* p = (const unsigned char*)str;
+    uint64_t seed = HASH_SECRET_0;
+    uint64_t a;
+    uint64_t b;
+
+    if (size <= 16)
     {
-        hash = AC_HASH(hash, str[i]);
-        i++;
+        if (size >= 4)
+        {
+            /* Two reads at each end, they overlap for less than 16 bytes. */
+            size_t middle = (size >> 3) << 2;
+            a = (hash_read32(p) << 32) | hash_read32(p + middle);
+            b = (hash_read32(p + size - 4) << 32) | hash_read32(p + size - 4 - middle);
+        }
+        else if (size > 0)
+        {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[size >> 1] << 8) | p[size - 1];
+            b = 0;
+        }
+        else
+        {
+            a = 0;
+            b = 0;
+        }
     }
+    else
+    {
+        size_t remaining = size;
+        while (remaining > 16)
+        {
+            seed = hash_mix(hash_read64(p) ^ HASH_SECRET_1, hash_read64(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        /* Last 16 bytes, they can overlap the previous ones. */
+        a = hash_read64(p + remaining - 16);
+        b = hash_read64(p + remaining - 8);
+    }
+
+    a ^= HASH_SECRET_1;
+    b ^= seed;
+    hash_multiply(&a, &b);
+    return (size_t)hash_mix(a ^ HASH_SECRET_0 ^ size, b ^ HASH_SECRET_1);
+}
 
-    return hash;
+uint64_t ac_time_ns()
+{
+#if _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+size_t ac_peak_rss()
+{
+#if _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return (size_t)usage.ru_maxrss;        /* Already in bytes. */
+#else
+    return (size_t)usage.ru_maxrss * 1024; /* Kilobytes on Linux. */
+#endif
+#endif
 }
\ No newline at end of file
@@ -20,8 +20,16 @@
 #define FNV1_OFFSET_BASIS (2166136261) 
 #define FNV1_HASH(h, c) ((uint32_t)((((unsigned)(c)) ^ (h)) * FNV1_PRIME))
 
-#define AC_HASH_INIT FNV1_OFFSET_BASIS
-#define AC_HASH(h, c) FNV1_HASH(h,c)
+#if defined(_MSC_VER)
+#define AC_THREAD_LOCAL __declspec(thread)
+#define AC_ALIGNOF(type) __alignof(type)
+#elif defined(__cplusplus)
+#define AC_THREAD_LOCAL thread_local
+#define AC_ALIGNOF(type) alignof(type)
+#else
+#define AC_THREAD_LOCAL _Thread_local
+#define AC_ALIGNOF(type) _Alignof(type)
+#endif
 
 #define AC_XSTRINGIZE(x) #x
 #define AC_STRINGIZE(x) AC_XSTRINGIZE(x)
@@ -38,8 +46,9 @@ struct global_options_t {
     bool display_surrounding_lines;
 };
 
-/* global_option set at the entry point of compilation. */
-extern global_options_t global_options;
+/* global_option of the current thread, set when a manager is initialized.
+   Threads compiling with a manager initialized by another thread must set it. */
+extern AC_THREAD_LOCAL global_options_t global_options;
 
 typedef struct ac_ast_expr ac_ast_expr;
 typedef struct ac_options ac_options;
@@ -58,11 +67,21 @@ void ac_report_warning_loc(ac_location loc, const char* fmt, ...);
 void ac_report_pp_warning_loc(ac_location loc, const char* fmt, ...);
 void ac_report_pp_error_loc(ac_location loc, const char* fmt, ...);
 
+/* Write the diagnostics of the current thread to 'file' instead of stderr, NULL to restore stderr. */
+void ac_set_report_file(FILE* file);
+
 void ac_report_error_expr(ac_ast_expr* expr, const char* fmt, ...);
 void ac_report_warning_expr(ac_ast_expr* expr, const char* fmt, ...);
 
+/* 64-bit hash of 'size' bytes, truncated to 32-bit when size_t is 32-bit.
+   The bytes are consumed 8 or 16 at a time. */
 size_t ac_hash(char* str, size_t size);
 
+/* Monotonic clock in nanoseconds. Only meaningful to compute durations. */
+uint64_t ac_time_ns();
+/* Peak resident set size of the process in bytes, 0 if not available. */
+size_t ac_peak_rss();
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,83 @@
+#include "intern.h"
+
+static ac_intern_shard* shard_of(ac_intern_table* t, size_t hash);
+
+
+void ac_intern_table_init(ac_intern_table* t)
+{
+    for (size_t i = 0; i < ac_intern_SHARD_COUNT; i += 1)
+    {
+        ac_intern_shard* s = &t->shards[i];
+        ac_rwlock_init(&s->lock);
+        ac_string_table_init(&s->strings);
+        ac_allocator_arena_init(&s->arena, 16 * 1024);
+    }
+}
+
+void ac_intern_table_destroy(ac_intern_table* t)
+{
+    for (size_t i = 0; i < ac_intern_SHARD_COUNT; i += 1)
+    {
+        ac_intern_shard* s = &t->shards[i];
+        ac_string_table_destroy(&s->strings);
+        ac_allocator_arena_destroy(&s->arena);
+        ac_rwlock_destroy(&s->lock);
+    }
+}
+
+strv ac_intern_table_get_or_add(ac_intern_table* t, strv text, size_t hash)
+{
+    ac_intern_shard* s = shard_of(t, hash);
+
+    /* Most strings are already interned, try with the read lock first. */
+    ac_string_entry entry;
+    entry.text = text;
+    entry.hash = hash;
+
+    ac_rwlock_read_lock(&s->lock);
+    ac_string_entry* existing = ac_string_table_get_item_h(&s->strings, &entry, hash);
+    strv result = existing ? existing->text : strv_make();
+    ac_rwlock_read_unlock(&s->lock);
+
+    if (existing)
+    {
+        return result;
+    }
+
+    ac_rwlock_write_lock(&s->lock);
+
+    /* Another thread could have added it in between. */
+    existing = ac_string_table_get_item_h(&s->strings, &entry, hash);
+    if (existing)
+    {
+        result = existing->text;
+    }
+    else
+    {
+        result.data = (const char*)ac_allocator_arena_allocate_bytes(&s->arena, text.size);
+        result.size = text.size;
+        memcpy((char*)result.data, text.data, text.size);
+
+        entry.text = result;
+        ac_string_table_insert_h(&s->strings, &entry, hash);
+    }
+
+    ac_rwlock_write_unlock(&s->lock);
+    return result;
+}
+
+size_t ac_intern_table_count(ac_intern_table* t)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < ac_intern_SHARD_COUNT; i += 1)
+    {
+        count += ac_string_table_size(&t->shards[i].strings);
+    }
+    return count;
+}
+
+static ac_intern_shard* shard_of(ac_intern_table* t, size_t hash)
+{
+    /* The lowest bits select the slot in the table of the shard, use the highest bits of the 32-bit hash. */
+    return &t->shards[((uint32_t)hash >> (32 - ac_intern_SHARD_BITS)) & (ac_intern_SHARD_COUNT - 1)];
+}
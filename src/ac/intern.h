@@ -0,0 +1,61 @@
+#ifndef AC_INTERN_H
+#define AC_INTERN_H
+
+#include "alloc.h"
+#include "thread_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Interned strings shared by managers running on different threads.
+    Strings are spread on shards according to their hash, each shard has its own lock,
+    its own table and its own arena. Finding an existing string only takes the read lock
+    of its shard, so threads interning the common identifiers of the headers don't block each other.
+*/
+
+/* String of a table with its hash, the strings are not hashed again when the table grows. */
+typedef struct ac_string_entry ac_string_entry;
+struct ac_string_entry {
+    strv text;
+    size_t hash;
+};
+
+#define ac_string_hash(e) ((e)->hash)
+#define ac_strings_are_same(left, right) \
+    ((left)->hash == (right)->hash && strv_equals((left)->text, (right)->text))
+SWISST_DECLARE(ac_string_table, ac_string_entry)
+SWISST_DEFINE(ac_string_table, ac_string_entry, ac_string_hash, ac_strings_are_same)
+
+enum {
+    ac_intern_SHARD_BITS = 6,
+    ac_intern_SHARD_COUNT = 1 << ac_intern_SHARD_BITS,
+};
+
+typedef struct ac_intern_shard ac_intern_shard;
+struct ac_intern_shard {
+    ac_rwlock lock;
+    ac_string_table strings;
+    ac_allocator_arena arena; /* Content of the strings. */
+};
+
+typedef struct ac_intern_table ac_intern_table;
+struct ac_intern_table {
+    ac_intern_shard shards[ac_intern_SHARD_COUNT];
+};
+
+void ac_intern_table_init(ac_intern_table* t);
+void ac_intern_table_destroy(ac_intern_table* t);
+
+/* Returns the interned copy of 'text', it lives as long as the table. Can be called from any thread. */
+strv ac_intern_table_get_or_add(ac_intern_table* t, strv text, size_t hash);
+
+/* Number of strings. Must not be called while other threads are interning. */
+size_t ac_intern_table_count(ac_intern_table* t);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_INTERN_H */
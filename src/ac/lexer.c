@@ -3,6 +3,7 @@
 #include "float.h"  /* FLT_MAX */
 
 #include "global.h"
+#include "stats.h"
 
 #define AC_EOF ('\0')
 
@@ -22,7 +23,7 @@ static const strv utf16 = STRV("u");
 static const strv utf32 = STRV("U");
 static const strv wide = STRV("L");
 
-static ac_token_info token_infos[ac_token_type_COUNT];
+static const ac_token_info token_infos[ac_token_type_COUNT];
 
 static bool is_horizontal_whitespace(char c);      /* char is alphanumeric */
 static bool is_identifier(char c);                 /* char is allowed in identifier */
@@ -42,6 +43,7 @@ static int skip_if_splice(ac_lex* l);        /* Get character after the current
 static int next_char_no_splice(ac_lex* l);   /* Get next character ignoring splices. */
 static int next_digit(ac_lex* l);         /* Get next digit, ignoring quotes and underscores. Push the digit to the token_buf. */
 
+static ac_token* goto_next_token(ac_lex* l); /* Lex the next token, see ac_lex_goto_next. */
 static ac_token* token_from_text(ac_lex* l, enum ac_token_type type, strv text); /* set current token and got to next */
 static ac_token* token_error(ac_lex* l); /* set current token to error and returns it. */
 static ac_token* token_eof(ac_lex* l);   /* set current token to eof and returns it. */
@@ -65,7 +67,7 @@ static ac_token* parse_integer_or_float_literal(ac_lex* l, int previous, int c);
 
 static void* utf8_decode(void* p, int32_t* pc);
 
-static strv string_or_char_literal_to_buffer(ac_lex* l, char quote, dstr* str);
+static strv string_or_char_literal_to_buffer(ac_lex* l, char quote, dstr* str);  /* Literal is only skipped if 'str' is NULL. */
 static ac_token* parse_string_literal(ac_lex* l, strv prefix);
 static ac_token* token_string(ac_lex* l, strv literal, strv kind);
 
@@ -77,6 +79,22 @@ static bool token_type_is_literal(enum ac_token_type type);
 static void location_increment_row(ac_location* l, int char_count);
 static void location_increment_column(ac_location* l, int char_count);
 
+static bool is_starting_directive(/* enum ac_token_type */ int type); /* #if, #ifdef or #ifndef */
+static bool is_ending_directive(/* enum ac_token_type */ int type);   /* #elif, #elifdef, #elifndef, #else or #endif */
+static ac_token* goto_directive_name(ac_lex* l); /* From '#' to the name of the directive. */
+/* Go to the name of the next directive and returns it, returns EOF if there is none.
+   'directive' receives the location of the '#' if not NULL. */
+static ac_token* goto_next_directive(ac_lex* l, bool* was_end_of_line, ac_directive* directive);
+static void build_directive_index(ac_lex* l, ac_directive_index* index);
+/* Returns the directive ending the current block, or NULL if the index cannot be used. */
+static ac_token* jump_to_ending_directive(ac_lex* l, ac_directive_index* index);
+/* Index of the first directive at or after the offset. */
+static size_t directive_lower_bound(ac_directive_index* index, size_t offset);
+/* Row that the lexer would have at 'offset' if it started from the beginning of the file. */
+static int indexed_row(ac_lex* l, ac_directive_index* index, size_t offset);
+/* Move to the '#' of the directive. 'row_delta' is the difference caused by #line directives. */
+static void jump_to_directive(ac_lex* l, ac_directive* d, int row_delta);
+
 /*
 -------------------------------------------------------------------------------
 w_lex
@@ -95,12 +113,10 @@ void ac_lex_init(ac_lex* l, ac_manager* mgr)
     }
 
     dstr_init(&l->tok_buf);
-    dstr_init(&l->str_buf);
 }
 
 void ac_lex_destroy(ac_lex* l)
 {
-    dstr_destroy(&l->str_buf);
     dstr_destroy(&l->tok_buf);
     memset(l, 0, sizeof(ac_lex));
 }
@@ -122,9 +138,17 @@ void ac_lex_set_content(ac_lex* l, strv content, strv filepath)
     }
 
     l->beginning_of_line = true;
+    l->entry = NULL;
 }
 
 ac_token* ac_lex_goto_next(ac_lex* l)
+{
+    ac_token* t = goto_next_token(l);
+    AC_STATS_ADD(token_counts[t->type], 1);
+    return t;
+}
+
+static ac_token* goto_next_token(ac_lex* l)
 {
     memset(&l->token, 0, sizeof(ac_token));
 
@@ -406,29 +430,29 @@ ac_token* ac_lex_goto_next(ac_lex* l)
         parse_identifier:
             AC_ASSERT(is_identifier(l->cur[0]));
 
-            size_t hash = AC_HASH_INIT;
-
+            /* Scan the identifier without the bookkeeping of consume_one,
+               an identifier cannot contain a new line. */
             const char* start = l->cur;
-            int n = 0;
-            do {
-                ++n;
-                hash = AC_HASH(hash, l->cur[0]); /* Calculate hash while we parse the identifier. */
-                /* @OPT: If this a "bottleneck" of the lexer, it can be improved.
-                consume_one can be replaced with a more lightweight function
-                that does not care about new_lines. */
-                consume_one(l);
-            } while (is_identifier(l->cur[0]));
+            const char* end = start + 1;
+            while (is_identifier(end[0]))
+            {
+                ++end;
+            }
+            size_t n = end - start;
+            AC_STATS_ADD(consumed_char_count, n);
+            l->cur = end;
+            l->location.col += (int)n;
+            l->location.pos += (int)n;
 
             ac_token token;
             strv ident;
             if (is_char(l, '\\')) /* Stray found. We need to create a new string without it and reparse the identifier. */
             {
-                dstr_assign(&l->tok_buf, strv_make_from(start, l->cur - start));
+                dstr_assign(&l->tok_buf, strv_make_from(start, n));
                 int c = skip_if_splice(l);
 
                 while (is_identifier(c))
                 {
-                    hash = AC_HASH(hash, l->cur[0]);
                     dstr_append_char(&l->tok_buf, c);
                     c = next_char_no_splice(l);
                 }
@@ -456,9 +480,12 @@ ac_token* ac_lex_goto_next(ac_lex* l)
                 else if (strv_equals(ident, wide)) return parse_string_literal(l, wide);
             }
 
+            /* The bytes of the identifier have just been scanned, they are still in cache. */
+            size_t hash = ac_hash((char*)ident.data, ident.size);
             ac_ident_holder id = ac_create_or_reuse_identifier_h(l->mgr, ident, hash);
             l->token.type = (enum ac_token_type)id.token_type; /* Is and identifier or a keyword. */
             l->token.ident = id.ident;
+            l->beginning_of_line = false;
             return &l->token;
         }
 
@@ -526,6 +553,7 @@ ac_lex_state ac_lex_save(ac_lex* l)
     s.leading_location = l->leading_location;
     s.location = l->location;
     s.beginning_of_line = l->beginning_of_line;
+    s.entry = l->entry;
 
     return s;
 }
@@ -543,6 +571,7 @@ void ac_lex_restore(ac_lex* l, ac_lex_state* s)
     l->leading_location = s->leading_location;
     l->location = s->location;
     l->beginning_of_line = s->beginning_of_line;
+    l->entry = s->entry;
 }
 
 /*
@@ -562,23 +591,188 @@ void ac_lex_restore(ac_lex* l, ac_lex_state* s)
            #endif'
 
         #endif
+
+    When a file is included more than once, all its directives are indexed the first time a block needs to be skipped.
+    The following skipped blocks of the file are jumping directly to the directive ending the block.
 */
 ac_token* ac_skip_preprocessor_block(ac_lex* l, bool was_end_of_line)
 {
-    int c;
+    if (l->entry && l->entry->load_count > 1)
+    {
+        ac_directive_index* index = &l->entry->directives;
+        if (!index->is_built)
+        {
+            build_directive_index(l, index);
+        }
+
+        ac_token* t = index->is_valid ? jump_to_ending_directive(l, index) : NULL;
+        if (t)
+        {
+            return t;
+        }
+    }
+
     int nesting_level = 0;
+    ac_token* t;
+    while ((t = goto_next_directive(l, &was_end_of_line, NULL))->type != ac_token_type_EOF)
+    {
+        if (nesting_level == 0 && is_ending_directive(t->type))
+        {
+            return t;
+        }
+
+        if (is_starting_directive(t->type))
+            nesting_level += 1;
+        else if (t->type == ac_token_type_ENDIF)
+            nesting_level -= 1;
+    }
+
+    /* We should not encounter EOF in a preprocessor block. */
+    return t;
+}
+
+ac_token* ac_lex_goto_next_directive(ac_lex* l)
+{
+    AC_ASSERT(l->beginning_of_line);
+
+    if (l->entry)
+    {
+        ac_directive_index* index = &l->entry->directives;
+        if (!index->is_built)
+        {
+            build_directive_index(l, index);
+        }
+
+        if (index->is_valid)
+        {
+            size_t offset = l->cur - l->src;
+            size_t i = directive_lower_bound(index, offset);
+            if (i == index->count)
+            {
+                l->cur = l->end;
+                return token_eof(l);
+            }
+
+            jump_to_directive(l, index->items + i, l->location.row - indexed_row(l, index, offset));
+            return ac_lex_goto_next(l);
+        }
+    }
+
+    /* No index, look for the directive without tokenizing anything. */
+    bool was_end_of_line = true;
+    ac_directive d;
+    ac_token* t = goto_next_directive(l, &was_end_of_line, &d);
+    if (t->type == ac_token_type_EOF)
+    {
+        return t;
+    }
+
+    /* Go back to the '#'. */
+    jump_to_directive(l, &d, 0);
+    return ac_lex_goto_next(l);
+}
+
+void ac_consume_and_display_message(ac_lex* l, enum ac_token_type type)
+{
+    AC_ASSERT(type == ac_token_type_WARNING || type == ac_token_type_ERROR);
+
     ac_location loc = l->location;
 
+    dstr_clear(&l->tok_buf);
+
+    skip_horizontal_whitespace(l);
+
+    int c = l->cur[0]; 
+
+    /* Add every single character until EOF or end-of-line. */
+    do {
+        dstr_append_char(&l->tok_buf, c);
+        c = next_char_no_splice(l);
+    } while (c != '\n' && c != '\r' && c != '\0');
+
+ 
+    if (l->token.type == ac_token_type_ERROR)
+    {
+        ac_report_pp_error_loc(loc, "%s", l->tok_buf.data);
+    }
+    else
+    {
+        ac_report_pp_warning_loc(loc, "%s", l->tok_buf.data);
+    }
+
+    bool ended_with_new_line = c == '\n' || c == '\r';
+
+    if (ended_with_new_line)
+    {
+        location_increment_row(&l->location, 1);
+    }
+
+    /* The last token was the "error" or "warning", however we advanced past them and we are now on a EOF or new line,
+       The lexer is advanced to the next token to properly continue. */
+    ac_lex_goto_next(l);
+}
+
+ac_token* ac_parse_include_path(ac_lex* l)
+{
+    /* Current token is '<' and current char is the one following it. */
+    AC_ASSERT(l->token.type == ac_token_type_LESS);
+
+    l->leading_location = l->location;
+
+    strv literal = string_or_char_literal_to_buffer(l, '>', &l->tok_buf);
+    if (literal.data == strv_error.data)
+    {
+        return token_error(l);
+    }
+
+    return token_string(l, literal, no_prefix);
+}
+
+static bool is_starting_directive(int type)
+{
+    return type == ac_token_type_IF
+        || type == ac_token_type_IFDEF
+        || type == ac_token_type_IFNDEF;
+}
+
+static bool is_ending_directive(int type)
+{
+    return type == ac_token_type_ELSE
+        || type == ac_token_type_ELIF
+        || type == ac_token_type_ELIFDEF
+        || type == ac_token_type_ELIFNDEF
+        || type == ac_token_type_ENDIF;
+}
+
+static ac_token* goto_directive_name(ac_lex* l)
+{
+    AC_ASSERT(is_char(l, '#'));
+
+    consume_one(l); /* Skip '#'. */
+    ac_token* t;
+
+    /* Skip all whitespace and comment. */
+    do {
+        t = ac_lex_goto_next(l);
+    } while (t->type == ac_token_type_HORIZONTAL_WHITESPACE
+        || t->type == ac_token_type_COMMENT);
+
+    return t;
+}
+
+static ac_token* goto_next_directive(ac_lex* l, bool* was_end_of_line, ac_directive* directive)
+{
+    int c;
     for (;;)
     {
         c = *l->cur;
         switch (c) {
-        case '\0': /* We should not encounter EOF in a preprocessor block. */
+        case '\0':
             return token_eof(l);
         case '\r':
         case '\n':
             skip_newlines(l);
-            was_end_of_line = true;
+            *was_end_of_line = true;
             continue;
         case '/':
             c = consume_one(l);
@@ -592,7 +786,7 @@ ac_token* ac_skip_preprocessor_block(ac_lex* l, bool was_end_of_line)
             }
             else
             {
-                was_end_of_line = false;
+                *was_end_of_line = false;
                 break;
             }
             /* Fallthrough */
@@ -607,116 +801,181 @@ ac_token* ac_skip_preprocessor_block(ac_lex* l, bool was_end_of_line)
         case '\'':
         case '"':
         {
-            consume_one(l); /* Skip '"' or '''. */
+            consume_one(l); /* Skip '"' or '\''. */
             /* Consume the string or char literal but do not create any token. */
             string_or_char_literal_to_buffer(l, c, NULL);
             continue;
         }
         case '#':
-            if (was_end_of_line)
+            if (*was_end_of_line)
             {
-                consume_one(l); /* Skip '#'. */
-                ac_token* t;
-
-                /* Skip all whitespace and comment. */
-                do {
-                    t = ac_lex_goto_next(l);
-                } while (t->type == ac_token_type_HORIZONTAL_WHITESPACE
-                    || t->type == ac_token_type_COMMENT);
-                
-                
-                bool is_ending_token = t->type == ac_token_type_ELSE
-                    || t->type == ac_token_type_ELIF
-                    || t->type == ac_token_type_ELIFDEF
-                    || t->type == ac_token_type_ELIFNDEF
-                    || t->type == ac_token_type_ENDIF;
-
-                if (nesting_level == 0 && is_ending_token)
+                if (directive)
                 {
-                    return t;
+                    directive->offset = l->cur - l->src;
+                    directive->row = l->location.row;
+                    directive->col = l->location.col;
+                    directive->pos = l->location.pos;
                 }
 
-                bool is_starting_token = t->type == ac_token_type_IF
-                    || t->type == ac_token_type_IFDEF
-                    || t->type == ac_token_type_IFNDEF;
-                if (is_starting_token)
-                    nesting_level += 1;
-                else if (t->type == ac_token_type_ENDIF)
-                    nesting_level -= 1;
+                ac_token* t = goto_directive_name(l);
 
-                continue;
+                /* The rest of the directive line cannot contain another directive, unless the directive was empty. */
+                *was_end_of_line = t->type == ac_token_type_NEW_LINE;
+                return t;
             }
             /* Fallthrough */
         default:
             consume_one(l);
-            was_end_of_line = false;
+            *was_end_of_line = false;
         }
     }
     AC_ASSERT(0 && "Unreachable");
     return token_eof(l);
 }
 
-void ac_consume_and_display_message(ac_lex* l, enum ac_token_type type)
+static void build_directive_index(ac_lex* l, ac_directive_index* index)
 {
-    AC_ASSERT(type == ac_token_type_WARNING || type == ac_token_type_ERROR);
-
-    ac_location loc = l->location;
+    AC_ASSERT(!index->is_built);
+
+    /* Scan the whole file with a separate lexer to not disturb the current one. */
+    ac_lex scan;
+    ac_lex_init(&scan, l->mgr);
+    ac_lex_set_content(&scan, strv_make_from(l->src, l->end - l->src), l->filepath);
+
+    darrT(ac_directive) items;
+    darrT(size_t) opened; /* Index of the last directive of each opened conditional. */
+    darrT_init(&items);
+    darrT_init(&opened);
+
+    bool is_valid = true;
+    bool was_end_of_line = true;
+    ac_directive d;
+    ac_token* t;
+    while ((t = goto_next_directive(&scan, &was_end_of_line, &d))->type != ac_token_type_EOF)
+    {
+        size_t i = darrT_size(&items);
+        d.type = t->type;
+        d.partner = (size_t)-1;
 
-    dstr_clear(&l->tok_buf);
+        if (is_ending_directive(t->type))
+        {
+            if (darrT_size(&opened) == 0)
+            {
+                is_valid = false;
+                break;
+            }
 
-    skip_horizontal_whitespace(l);
+            size_t last = darrT_at(&opened, darrT_size(&opened) - 1);
+            darrT_ptr(&items, last)->partner = i;
 
-    int c = l->cur[0]; 
+            if (t->type == ac_token_type_ENDIF)
+                darrT_pop_back(&opened);
+            else
+                darrT_set(&opened, darrT_size(&opened) - 1, i);
+        }
+        else if (is_starting_directive(t->type))
+        {
+            darrT_push_back(&opened, i);
+        }
 
-    /* Add every single character until EOF or end-of-line. */
-    do {
-        dstr_append_char(&l->tok_buf, c);
-        c = next_char_no_splice(l);
-    } while (c != '\n' && c != '\r' && c != '\0');
+        darrT_push_back(&items, d);
+    }
 
- 
-    if (l->token.type == ac_token_type_ERROR)
+    if (t->is_premature_eof || darrT_size(&opened) != 0)
     {
-        ac_report_pp_error_loc(loc, "%s", l->tok_buf.data);
+        is_valid = false;
     }
-    else
+
+    index->is_built = true;
+    index->is_valid = is_valid;
+    index->count = 0;
+    index->items = NULL;
+
+    if (is_valid && darrT_size(&items))
     {
-        ac_report_pp_warning_loc(loc, "%s", l->tok_buf.data);
+        index->count = darrT_size(&items);
+        /* The identifiers arena also holds records of any size, the items must be aligned. */
+        index->items = ac_allocator_arena_allocate_aligned(&l->mgr->identifiers_arena, sizeof(ac_directive) * index->count, AC_ALIGNOF(ac_directive));
+        memcpy(index->items, darrT_ptr(&items, 0), sizeof(ac_directive) * index->count);
     }
 
-    bool ended_with_new_line = c == '\n' || c == '\r';
+    darrT_destroy(&opened);
+    darrT_destroy(&items);
+    ac_lex_destroy(&scan);
+}
 
-    if (ended_with_new_line)
+static ac_token* jump_to_ending_directive(ac_lex* l, ac_directive_index* index)
+{
+    size_t offset = l->cur - l->src;
+
+    /* Find the last directive before the current position, it's the one that started the block. */
+    size_t low = directive_lower_bound(index, offset);
+    if (low == 0)
     {
-        location_increment_row(&l->location, 1);
+        return NULL;
     }
 
-    /* The last token was the "error" or "warning", however we advanced past them and we are now on a EOF or new line,
-       The lexer is advanced to the next token to properly continue. */
-    ac_lex_goto_next(l);
+    ac_directive* starting = index->items + low - 1;
+    if (starting->partner == (size_t)-1)
+    {
+        return NULL;
+    }
+
+    ac_directive* ending = index->items + starting->partner;
+
+    /* The current row can differ from the indexed one because of #line, the difference is preserved. */
+    jump_to_directive(l, ending, l->location.row - indexed_row(l, index, offset));
+
+    ac_token* t = goto_directive_name(l);
+    AC_ASSERT(t->type == ending->type);
+    return t;
 }
 
-ac_token* ac_parse_include_path(ac_lex* l)
+static size_t directive_lower_bound(ac_directive_index* index, size_t offset)
 {
-    /* Current token is '<' and current char is the one following it. */
-    AC_ASSERT(l->token.type == ac_token_type_LESS);
+    size_t low = 0;
+    size_t high = index->count;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (index->items[mid].offset < offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
 
-    l->leading_location = l->location;
+static int indexed_row(ac_lex* l, ac_directive_index* index, size_t offset)
+{
+    /* Count the lines from the previous directive, or from the beginning of the file. */
+    size_t i = directive_lower_bound(index, offset);
+    int row = i ? index->items[i - 1].row : 1;
+    const char* c = i ? l->src + index->items[i - 1].offset : l->src;
 
-    strv literal = string_or_char_literal_to_buffer(l, '>', &l->tok_buf);
-    if (literal.data == strv_error.data)
+    for (const char* end = l->src + offset; c < end; c += 1)
     {
-        return token_error(l);
+        if (*c == '\n' || (*c == '\r' && c[1] != '\n'))
+        {
+            row += 1;
+        }
     }
-
-    return token_string(l, literal, no_prefix);
+    return row;
 }
 
-static ac_token eof = {ac_token_type_EOF};
+static void jump_to_directive(ac_lex* l, ac_directive* d, int row_delta)
+{
+    l->cur = l->src + d->offset;
+    l->location.row = d->row + row_delta;
+    l->location.col = d->col;
+    l->location.pos = d->pos;
+    l->beginning_of_line = true;
+}
 
-ac_token* ac_token_eof()
+ac_token ac_token_eof()
 {
-    return &eof;
+    ac_token eof = {ac_token_type_EOF};
+    return eof;
 }
 
 ac_token* ac_set_token_error(ac_lex* l)
@@ -765,6 +1024,7 @@ static bool next_next_is(const ac_lex* l, char c) {
 
 /* We consume one char at a time to handle new lines and row/line numbers which change the location of tokens. */
 static inline int consume_one(ac_lex* l) {
+    AC_STATS_ADD(consumed_char_count, 1);
     l->cur++;
     location_increment_column(&l->location, 1);
     return l->cur[0];
@@ -972,7 +1232,7 @@ static ac_token* token_eof(ac_lex* l) {
 }
 
 static ac_token* token_from_type(ac_lex* l, enum ac_token_type type) {
-    return token_from_text(l, type, token_infos[type].ident.text);
+    return token_from_text(l, type, token_infos[type].text);
 }
 
 static ac_token* token_from_single_char(ac_lex* l, enum ac_token_type type) {
@@ -1115,6 +1375,7 @@ static ac_token* token_integer_literal(ac_lex* l, ac_token_number num)
 {
     l->token.type = ac_token_type_LITERAL_INTEGER;
     l->token.u.number = num;
+    l->beginning_of_line = false;
 
     if (!parse_integer_suffix(l, &l->token.u.number))
     {
@@ -1131,6 +1392,7 @@ static ac_token* token_float_literal(ac_lex* l, ac_token_number num)
 {
     l->token.type = ac_token_type_LITERAL_FLOAT;
     l->token.u.number = num;
+    l->beginning_of_line = false;
 
     if (!parse_float_suffix(l, &l->token.u.number))
     {
@@ -1526,7 +1788,10 @@ exit_loop:
     }
 
     if (c != ending_char) {
-        ac_report_error_loc(l->leading_location, "missing terminating char '%c' for literal", ending_char);
+        /* Unterminated literals are allowed in skipped blocks. */
+        if (buf) {
+            ac_report_error_loc(l->leading_location, "missing terminating char '%c' for literal", ending_char);
+        }
         return strv_error;
     }
 
@@ -1554,6 +1819,7 @@ static ac_token* parse_string_literal(ac_lex* l, strv prefix) {
 static ac_token* token_string(ac_lex* l, strv literal, strv prefix)
 {
     l->token.type = ac_token_type_LITERAL_STRING;
+    l->beginning_of_line = false;
 
     l->token.text = ac_create_or_reuse_literal(l->mgr, literal);
 
@@ -1581,6 +1847,7 @@ static ac_token* token_char(ac_lex* l, strv prefix)
         return token_error(l);
 
     l->token.type = ac_token_type_LITERAL_CHAR;
+    l->beginning_of_line = false;
 
     l->token.text = ac_create_or_reuse_literal(l->mgr, literal);
 
@@ -1616,9 +1883,9 @@ ac_token
 -------------------------------------------------------------------------------
 */
 
-#define IDENT(value) { STRV(value) }
+#define IDENT(value) STRV(value)
 
-static ac_token_info token_infos[] = {
+static const ac_token_info token_infos[] = {
 
     { false, ac_token_type_NONE, IDENT("<none>") },
     { false, ac_token_type_EMPTY, IDENT("") },
@@ -1786,7 +2053,7 @@ const char* ac_token_type_to_str(enum ac_token_type type) {
 
 strv ac_token_type_to_strv(enum ac_token_type type)
 {
-    return token_infos[type].ident.text;
+    return token_infos[type].text;
 }
 
 const char* ac_token_to_str(ac_token token) {
@@ -1858,7 +2125,7 @@ void ac_token_sprint(dstr* str, ac_token t)
     dstr_append_f(str, format, STRV_ARG(s));
 }
 
-ac_token_info* ac_token_infos()
+const ac_token_info* ac_token_infos()
 {
     return token_infos;
 }
@@ -1894,7 +2161,7 @@ strv ac_token_prefix(ac_token token) {
 static size_t token_str_len(enum ac_token_type type) {
     AC_ASSERT(!token_type_is_literal(type));
 
-    return token_infos[type].ident.text.size;
+    return token_infos[type].text.size;
 }
 
 static bool token_type_is_literal(enum ac_token_type type) {
@@ -186,13 +186,28 @@ struct ac_token_number {
 
 typedef struct ac_macro ac_macro;
 
+/* Identifiers are interned by a manager, the keywords included, and modified by its preprocessors.
+   They must not be shared by managers running on different threads.
+   The text of an interned identifier directly follows it in the identifiers arena,
+   unless the text is shared with other managers. The text of the keywords is static. */
 typedef struct ac_ident ac_ident;
 struct ac_ident {
     strv text;
-    ac_macro* macro; /* Contains macro if macro was defined, NULL otherwise. */
-    bool cannot_expand;
+    size_t hash; /* ac_hash of the text, computed once when the identifier is interned. */
+    /* Cache of the macro from the macro map of the preprocessor having the same generation.
+       Contains macro if macro was defined, NULL otherwise. */
+    ac_macro* macro;
+    uint32_t macro_generation; /* Truncated, past 2^32 generations it never matches and the map is always searched. */
+    bool cannot_expand; /* True while the macro of this name is being expanded. */
 };
 
+/* Every identifier and keyword of every file is looked up in the identifier table of the manager,
+   its hash and its comparison are inlined. */
+#define ac_ident_holder_hash(holder) ((holder)->ident->hash)
+#define ac_ident_holders_are_same(left, right) \
+    ((left)->ident->hash == (right)->ident->hash && strv_equals((left)->ident->text, (right)->ident->text))
+SWISST_DEFINE(ac_ident_table, ac_ident_holder, ac_ident_holder_hash, ac_ident_holders_are_same)
+
 typedef struct ac_token ac_token;
 struct ac_token {
     enum ac_token_type type;
@@ -239,7 +254,7 @@ typedef struct ac_token_info ac_token_info;
 struct ac_token_info {
     bool is_supported;
     enum ac_token_type type;
-    ac_ident ident;
+    strv text;
 };
 
 /* @TODO move this to the compiler options. */
@@ -264,8 +279,8 @@ struct ac_lex {
     ac_location leading_location; /* Location when at the very begining of ac_lex_goto_next. */
     ac_location location; /* Current location */
     dstr tok_buf;         /* Token buffer in case we can't just use a string view to the memory. */
-    dstr str_buf;         /* Buffer for string conversion. */
     bool beginning_of_line;
+    ac_file_entry* entry; /* Entry of the file being lexed, NULL if the content does not come from a file of the manager. */
 };
 
 void ac_lex_init(ac_lex* l, ac_manager* mgr);
@@ -302,6 +317,7 @@ struct ac_lex_state {
     ac_location leading_location;
     ac_location location;
     bool beginning_of_line;
+    ac_file_entry* entry;
 };
 
 ac_lex_state ac_lex_save(ac_lex* l);
@@ -310,6 +326,10 @@ void ac_lex_restore(ac_lex* l, ac_lex_state* s);
 /* Skip block of text between #if and #endif. */
 ac_token* ac_skip_preprocessor_block(ac_lex* l, bool was_end_of_line);
 
+/* Skip all text until the next directive without tokenizing it.
+   Must be called at the beginning of a line, returns the '#' of the directive or EOF. */
+ac_token* ac_lex_goto_next_directive(ac_lex* l);
+
 /* Display all tokens after #warning or #error until EOF or end-of-line. 
    'type' must be a warning or an error. */
 void ac_consume_and_display_message(ac_lex* l, enum ac_token_type type);
@@ -318,7 +338,7 @@ void ac_consume_and_display_message(ac_lex* l, enum ac_token_type type);
 ac_token* ac_parse_include_path(ac_lex* l);
 
 /* Returns a "stand-alone" EOF token */
-ac_token* ac_token_eof();
+ac_token ac_token_eof();
 
 /* Mark the current token as EOF and as premature EOF, then returns it. */
 ac_token* ac_set_token_error(ac_lex* l);
@@ -330,7 +350,7 @@ strv ac_token_to_strv(ac_token t);
 void ac_token_fprint(FILE* file, ac_token t); /* Print to file. */
 void ac_token_sprint(dstr* str, ac_token t);  /* Print to dynamic string. */
 
-ac_token_info* ac_token_infos();
+const ac_token_info* ac_token_infos();
 
 bool ac_token_is_keyword_or_identifier(enum ac_token_type type);
 strv ac_token_prefix(ac_token t);
@@ -0,0 +1,224 @@
+#include "macro_map.h"
+
+/*
+    Each level of the trie consumes BITS_PER_LEVEL bits of the hash.
+    A node contains a bitmap of the slots holding an entry and a bitmap of the slots holding a child node.
+    Only the used slots are allocated, the index of a slot in its array is the number of bits set before its own bit.
+
+    The hash of an identifier is a bijective mix of its address.
+    Two different identifiers always end up with two different hashes, so there is no collision to handle
+    at the last level of the trie.
+*/
+
+enum {
+    BITS_PER_LEVEL = 5,
+    SLOT_MASK = (1 << BITS_PER_LEVEL) - 1,
+    MAX_SHIFT = 64,
+};
+
+typedef struct entry entry;
+struct entry {
+    ac_ident* ident;
+    ac_macro* macro; /* NULL if the macro has been undefined. */
+};
+
+struct ac_macro_map_node {
+    uint32_t entry_map;
+    uint32_t child_map;
+    entry* entries;               /* One entry for each bit of entry_map. */
+    ac_macro_map_node** children; /* One child for each bit of child_map. */
+};
+
+static uint64_t ident_hash(const ac_ident* ident);
+static uint32_t slot_bit(uint64_t hash, int shift);
+static int slot_index(uint32_t map, uint32_t bit); /* Index of the slot in its array. */
+static int bit_count(uint32_t value);
+
+/* Allocate a node with the entries and children arrays right after it. */
+static ac_macro_map_node* allocate_node(ac_allocator* a, uint32_t entry_map, uint32_t child_map);
+/* Create a node containing two entries that could not be stored in the same slot at the previous level. */
+static ac_macro_map_node* make_pair(ac_allocator* a, entry left, uint64_t left_hash, entry right, uint64_t right_hash, int shift);
+static ac_macro_map_node* set(ac_allocator* a, const ac_macro_map_node* n, entry e, uint64_t hash, int shift, ac_macro** previous);
+
+void ac_macro_map_init(ac_macro_map* map)
+{
+    map->root = NULL;
+    map->count = 0;
+}
+
+ac_macro* ac_macro_map_get(const ac_macro_map* map, const ac_ident* ident)
+{
+    uint64_t hash = ident_hash(ident);
+    const ac_macro_map_node* n = map->root;
+
+    for (int shift = 0; n && shift < MAX_SHIFT; shift += BITS_PER_LEVEL)
+    {
+        uint32_t bit = slot_bit(hash, shift);
+
+        if (n->entry_map & bit)
+        {
+            entry* e = n->entries + slot_index(n->entry_map, bit);
+            return e->ident == ident ? e->macro : NULL;
+        }
+
+        n = (n->child_map & bit)
+            ? n->children[slot_index(n->child_map, bit)]
+            : NULL;
+    }
+
+    return NULL;
+}
+
+ac_macro_map ac_macro_map_set(const ac_macro_map* map, ac_allocator* a, ac_ident* ident, ac_macro* macro)
+{
+    /* Nothing to undefine. */
+    if (macro == NULL && ac_macro_map_get(map, ident) == NULL)
+    {
+        return *map;
+    }
+
+    entry e = { ident, macro };
+    ac_macro* previous = NULL;
+
+    ac_macro_map result;
+    result.root = set(a, map->root, e, ident_hash(ident), 0, &previous);
+    result.count = map->count
+        + (previous == NULL && macro != NULL)
+        - (previous != NULL && macro == NULL);
+
+    return result;
+}
+
+static uint64_t ident_hash(const ac_ident* ident)
+{
+    /* Finalizer of splitmix64, it's a bijection. */
+    uint64_t h = (uint64_t)(uintptr_t)ident;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+static uint32_t slot_bit(uint64_t hash, int shift)
+{
+    return (uint32_t)1 << ((hash >> shift) & SLOT_MASK);
+}
+
+static int slot_index(uint32_t map, uint32_t bit)
+{
+    return bit_count(map & (bit - 1));
+}
+
+static int bit_count(uint32_t value)
+{
+    value = value - ((value >> 1) & 0x55555555u);
+    value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+    value = (value + (value >> 4)) & 0x0f0f0f0fu;
+    return (int)((value * 0x01010101u) >> 24);
+}
+
+static ac_macro_map_node* allocate_node(ac_allocator* a, uint32_t entry_map, uint32_t child_map)
+{
+    int entry_count = bit_count(entry_map);
+    int child_count = bit_count(child_map);
+
+    size_t size = sizeof(ac_macro_map_node)
+        + sizeof(entry) * entry_count
+        + sizeof(ac_macro_map_node*) * child_count;
+
+    ac_macro_map_node* n = ac_allocator_allocate(a, size);
+    n->entry_map = entry_map;
+    n->child_map = child_map;
+    n->entries = (entry*)(n + 1);
+    n->children = (ac_macro_map_node**)(n->entries + entry_count);
+    return n;
+}
+
+static ac_macro_map_node* make_pair(ac_allocator* a, entry left, uint64_t left_hash, entry right, uint64_t right_hash, int shift)
+{
+    AC_ASSERT(shift < MAX_SHIFT && "Two identifiers cannot have the same hash.");
+
+    uint32_t left_bit = slot_bit(left_hash, shift);
+    uint32_t right_bit = slot_bit(right_hash, shift);
+
+    /* Still in the same slot, go one level deeper. */
+    if (left_bit == right_bit)
+    {
+        ac_macro_map_node* n = allocate_node(a, 0, left_bit);
+        n->children[0] = make_pair(a, left, left_hash, right, right_hash, shift + BITS_PER_LEVEL);
+        return n;
+    }
+
+    ac_macro_map_node* n = allocate_node(a, left_bit | right_bit, 0);
+    n->entries[slot_index(n->entry_map, left_bit)] = left;
+    n->entries[slot_index(n->entry_map, right_bit)] = right;
+    return n;
+}
+
+static ac_macro_map_node* set(ac_allocator* a, const ac_macro_map_node* n, entry e, uint64_t hash, int shift, ac_macro** previous)
+{
+    uint32_t bit = slot_bit(hash, shift);
+
+    /* Empty map, create the root. */
+    if (n == NULL)
+    {
+        ac_macro_map_node* result = allocate_node(a, bit, 0);
+        result->entries[0] = e;
+        return result;
+    }
+
+    int entry_count = bit_count(n->entry_map);
+    int child_count = bit_count(n->child_map);
+
+    /* The slot contains an entry. */
+    if (n->entry_map & bit)
+    {
+        int i = slot_index(n->entry_map, bit);
+        entry existing = n->entries[i];
+
+        /* Same identifier, only replace the entry. */
+        if (existing.ident == e.ident)
+        {
+            *previous = existing.macro;
+
+            ac_macro_map_node* result = allocate_node(a, n->entry_map, n->child_map);
+            memcpy(result->entries, n->entries, sizeof(entry) * entry_count);
+            memcpy(result->children, n->children, sizeof(ac_macro_map_node*) * child_count);
+            result->entries[i] = e;
+            return result;
+        }
+
+        /* Different identifier, both entries are moved to a new child node. */
+        ac_macro_map_node* child = make_pair(a, existing, ident_hash(existing.ident), e, hash, shift + BITS_PER_LEVEL);
+
+        ac_macro_map_node* result = allocate_node(a, n->entry_map & ~bit, n->child_map | bit);
+        memcpy(result->entries, n->entries, sizeof(entry) * i);
+        memcpy(result->entries + i, n->entries + i + 1, sizeof(entry) * (entry_count - i - 1));
+
+        int j = slot_index(result->child_map, bit);
+        memcpy(result->children, n->children, sizeof(ac_macro_map_node*) * j);
+        result->children[j] = child;
+        memcpy(result->children + j + 1, n->children + j, sizeof(ac_macro_map_node*) * (child_count - j));
+        return result;
+    }
+
+    /* The slot contains a child, the path to the entry is copied. */
+    if (n->child_map & bit)
+    {
+        int j = slot_index(n->child_map, bit);
+
+        ac_macro_map_node* result = allocate_node(a, n->entry_map, n->child_map);
+        memcpy(result->entries, n->entries, sizeof(entry) * entry_count);
+        memcpy(result->children, n->children, sizeof(ac_macro_map_node*) * child_count);
+        result->children[j] = set(a, n->children[j], e, hash, shift + BITS_PER_LEVEL, previous);
+        return result;
+    }
+
+    /* The slot is empty, add the entry. */
+    ac_macro_map_node* result = allocate_node(a, n->entry_map | bit, n->child_map);
+    int i = slot_index(result->entry_map, bit);
+    memcpy(result->entries, n->entries, sizeof(entry) * i);
+    result->entries[i] = e;
+    memcpy(result->entries + i + 1, n->entries + i, sizeof(entry) * (entry_count - i));
+    memcpy(result->children, n->children, sizeof(ac_macro_map_node*) * child_count);
+    return result;
+}
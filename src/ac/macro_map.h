@@ -0,0 +1,37 @@
+#ifndef AC_MACRO_MAP_H
+#define AC_MACRO_MAP_H
+
+#include "alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_ident ac_ident;
+typedef struct ac_macro ac_macro;
+typedef struct ac_macro_map_node ac_macro_map_node;
+
+/* Persistent map from identifiers to macros (hash array mapped trie).
+   Setting a value creates a new version of the map sharing most of its nodes with the previous one.
+   All versions remain valid, going back to a previous state is a simple copy of the ac_macro_map.
+   Nodes are never released individually, the allocator must outlive all the versions. */
+typedef struct ac_macro_map ac_macro_map;
+struct ac_macro_map {
+    ac_macro_map_node* root;
+    size_t count; /* Number of defined macros. */
+};
+
+void ac_macro_map_init(ac_macro_map* map);
+
+/* Returns the macro of the identifier, NULL if it's not defined. */
+ac_macro* ac_macro_map_get(const ac_macro_map* map, const ac_ident* ident);
+
+/* Returns a new version of the map where 'ident' is defined as 'macro', or undefined if 'macro' is NULL.
+   'map' is left untouched. */
+ac_macro_map ac_macro_map_set(const ac_macro_map* map, ac_allocator* a, ac_ident* ident, ac_macro* macro);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_MACRO_MAP_H */
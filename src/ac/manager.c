@@ -10,8 +10,16 @@
 #include "re/file.h"
 #include "re/path.h"
 
+#include "stats.h"
+
 #include "global.h"
 #include "lexer.h"
+#include "preprocessor.h"
+
+enum {
+    IDENTIFIER_BYTE_RATIO = 24,  /* Bytes of input per new identifier, see ac_manager_reserve_for_input. */
+    LITERAL_BYTE_RATIO = 512,    /* Bytes of input per new literal, see ac_manager_reserve_for_input. */
+};
 
 typedef struct source_file source_file;
 struct source_file {
@@ -24,26 +32,52 @@ struct source_file {
 #endif
     strv filepath;  /* NOTE: View to a null terminated string. */
     strv content;   /* NOTE: View to a null terminated string. */
+    ac_file_entry* entry;
+};
+
+/* Identity of the file, a file opened from different paths is mapped only once. */
+static size_t source_file_hash(const source_file* f);
+static bool source_files_are_same(const source_file* left, const source_file* right);
+SWISST_DEFINE(ac_file_table, source_file, source_file_hash, source_files_are_same)
+
+/* File loaded from a path. */
+struct ac_loaded_path {
+    strv path;
+    size_t hash; /* Hash of the path, it's not computed again when the table grows. */
+    source_file file;
 };
+#define loaded_path_hash(p) ((p)->hash)
+#define loaded_paths_are_same(left, right) ((left)->hash == (right)->hash && strv_equals((left)->path, (right)->path))
+SWISST_DEFINE(ac_path_table, struct ac_loaded_path, loaded_path_hash, loaded_paths_are_same)
+
+#define include_entry_hash(e) ((e)->hash)
+#define include_entries_are_same(left, right) \
+    (strv_equals((left)->path, (right)->path) && strv_equals((left)->dir, (right)->dir))
+SWISST_DEFINE(ac_include_table, ac_include_entry, include_entry_hash, include_entries_are_same)
+
+static size_t include_hash(strv dir, strv path);
 
 static bool load_source_file(ac_manager* m, char* filepath, source_file* result);
+/* Copy the text of a new identifier or literal in the shared strings if any, in the arena of the manager otherwise. */
+static strv intern_text(ac_manager* m, strv text, size_t hash);
 static strv allocate_filepath(ac_manager* m, const char* filepath);
+/* Copy text which only lives as long as the preprocessor. */
+static strv copy_to_preprocessor_arena(ac_manager* m, strv text);
+static ac_file_entry* allocate_file_entry(ac_manager* m);
+/* Arenas released once the AST is parsed, they are ready to be used again. */
+static void init_preprocessor_arenas(ac_manager* m, enum ac_arena_kind kind);
 
 /* mmap the file or get the already mmapped file.
    'filepath' is only used to report more meaningful errors. */
 static bool mmap_or_get_source_file(ac_manager* m, source_file* source_file, const char* filepath);
 /* Close file handle and unmap the file. */
 static bool unmap_source_file(source_file* source_file);
+/* Remove the pages of the file from the memory of the process, the content remains readable. */
+static void release_source_pages(source_file* source_file);
 
-/* Comparer for darr_map. */
-static darr_bool source_file_less_predicate(source_file* left, source_file* right);
 
-static ht_hash_t identifier_hash(ac_ident_holder* i);                               /* For hash table. */
-static ht_bool identifiers_are_same(ac_ident_holder* left, ac_ident_holder* right); /* For hash table. */
-static void swap_identifiers(ac_ident_holder* left, ac_ident_holder* right);        /* For hash table. */
-static ht_hash_t literal_hash(strv* sv);                                /* For hash table. */
-static ht_bool literals_are_same(strv* left, strv* right);              /* For hash table. */
-static void swap_literals(strv* left, strv* right);                     /* For hash table. */
+static void print_arena_usage(FILE* file, const char* name, ac_allocator_arena* a);
+static void print_table_usage(FILE* file, const char* name, size_t count, size_t bucket_count, size_t total_displacement, size_t max_displacement);
 
 void ac_options_init_default(ac_options* o)
 {
@@ -86,38 +120,41 @@ void ac_manager_init(ac_manager* m, ac_options* o)
     AC_ASSERT(o);
     memset(m, 0, sizeof(ac_manager));
 
-    ac_allocator_arena_init(&m->ast_arena, 16 * 1024);
-    ac_allocator_arena_init(&m->identifiers_arena, 16 * 1024);
+    /* Large arenas reserve their addresses once, nodes of the same file are not scattered
+       across chunks and growing them does not call malloc. */
+    ac_allocator_arena_init_kind(&m->ast_arena, o->arenas, (size_t)4 << 30);
+    ac_allocator_arena_init_kind(&m->identifiers_arena, o->arenas, (size_t)1 << 30);
+    ac_allocator_arena_init(&m->strings_arena, 16 * 1024);
+    init_preprocessor_arenas(m, o->arenas);
 
-    ht_init(&m->identifiers,
-        sizeof(ac_ident_holder),
-        (ht_hash_function_t)identifier_hash,
-        (ht_predicate_t)identifiers_are_same,
-        (ht_swap_function_t)swap_identifiers,
-        0);
+    ac_ident_table_init(&m->identifiers);
 
-    ht_init(&m->literals,
-        sizeof(strv),
-        (ht_hash_function_t)literal_hash,
-        (ht_predicate_t)literals_are_same,
-        (ht_swap_function_t)swap_literals,
-        0);
+    ac_string_table_init(&m->literals);
 
     m->options = o;
     global_options = o->global;
 
-    ac_token_info* infos = ac_token_infos();
+    const ac_token_info* infos = ac_token_infos();
     /* Register keywords and known tokens. */
     for (int i = 0; i < ac_token_type_COUNT; i += 1)
     {
-        ac_token_info* info = infos + i;
+        const ac_token_info* info = infos + i;
         if (info->is_supported && ac_token_is_keyword_or_identifier(info->type))
         {
-            ac_register_known_identifier(m, &info->ident, info->type);
+            /* Each manager has its own keywords since the preprocessor caches macros in the identifiers.
+               Only the text is shared. */
+            ac_ident* ident = ac_arena_new_zero(&m->identifiers_arena, ac_ident);
+            ident->text = info->text;
+            ac_register_known_identifier(m, ident, info->type);
         }
     }
 
-    darr_map_init(&m->opened_files, sizeof(source_file), (darr_predicate_t)source_file_less_predicate);
+    ac_file_table_init(&m->opened_files);
+    ac_path_table_init(&m->loaded_paths);
+    ac_include_table_init(&m->includes);
+    darrT_init(&m->loaded_filepaths);
+
+    darrT_init(&m->macros);
 
 #if _WIN32
     darrT_init(&m->wchars);
@@ -128,21 +165,31 @@ void ac_manager_init(ac_manager* m, ac_options* o)
 
 void ac_manager_destroy(ac_manager* m)
 {
-    ht_destroy(&m->identifiers);
-    ht_destroy(&m->literals);
+    ac_ident_table_destroy(&m->identifiers);
+    ac_string_table_destroy(&m->literals);
 
+    darrT_destroy(&m->macros);
+
+    ac_allocator_arena_destroy(&m->macro_map_arena);
+    ac_allocator_arena_destroy(&m->preprocessor_arena);
+    ac_allocator_arena_destroy(&m->strings_arena);
     ac_allocator_arena_destroy(&m->identifiers_arena);
     ac_allocator_arena_destroy(&m->ast_arena);
 
     /* Release all opened files. */
-    for (int i = 0; i < darr_map_size(&m->opened_files); i += 1)
+    for (size_t i = 0; i < m->opened_files.capacity; i += 1)
     {
-        source_file* src_file = darr_ptr(&m->opened_files.arr,i);
-        bool unmmapped = unmap_source_file(src_file);
-        AC_ASSERT(unmmapped);
+        if (m->opened_files.ctrl[i] != SWISST_EMPTY)
+        {
+            bool unmmapped = unmap_source_file(&m->opened_files.slots[i]);
+            AC_ASSERT(unmmapped);
+        }
     }
 
-    darr_map_destroy(&m->opened_files);
+    ac_file_table_destroy(&m->opened_files);
+    ac_path_table_destroy(&m->loaded_paths);
+    ac_include_table_destroy(&m->includes);
+    darrT_destroy(&m->loaded_filepaths);
 #if _WIN32
     darrT_destroy(&m->wchars);
 #endif
@@ -150,17 +197,33 @@ void ac_manager_destroy(ac_manager* m)
 
 bool ac_manager_load_content(ac_manager* m, char* filepath, ac_source_file* result)
 {
-    if (!re_file_exists_str(filepath))
+    source_file src_file;
+    struct ac_loaded_path key = { .path = strv_make_from_str(filepath) };
+    size_t hash = ac_hash((char*)key.path.data, key.path.size);
+    key.hash = hash;
+    struct ac_loaded_path* loaded = ac_path_table_get_item_h(&m->loaded_paths, &key, hash);
+    if (loaded)
     {
-        ac_report_error("file '%s' does not exist", filepath);
-        return false;
+        src_file = loaded->file;
     }
-
-    source_file src_file;
-    if (!load_source_file(m, filepath, &src_file))
+    else
     {
-        ac_report_error("could not load file '%s' into memory", filepath);
-        return false;
+        if (!re_file_exists_str(filepath))
+        {
+            ac_report_error("file '%s' does not exist", filepath);
+            return false;
+        }
+
+        if (!load_source_file(m, filepath, &src_file))
+        {
+            ac_report_error("could not load file '%s' into memory", filepath);
+            return false;
+        }
+
+        /* The path of the file can be another path to the same file, the key must be kept as well. */
+        key.path = allocate_filepath(m, filepath);
+        key.file = src_file;
+        ac_path_table_insert_h(&m->loaded_paths, &key, hash);
     }
 
     if (src_file.content.size == 0)
@@ -168,12 +231,125 @@ bool ac_manager_load_content(ac_manager* m, char* filepath, ac_source_file* resu
         ac_report_warning("empty file '%s'", filepath);
     }
 
+    if (src_file.entry->load_count == 0)
+    {
+        darrT_push_back(&m->loaded_filepaths, src_file.filepath);
+    }
+    src_file.entry->load_count += 1;
+
     result->filepath = src_file.filepath;
     result->content = src_file.content;
+    result->entry = src_file.entry;
 
     return true;
 }
 
+size_t ac_manager_loaded_file_count(ac_manager* m)
+{
+    return darrT_size(&m->loaded_filepaths);
+}
+
+strv ac_manager_loaded_filepath(ac_manager* m, size_t index)
+{
+    AC_ASSERT(index < ac_manager_loaded_file_count(m));
+    return darrT_at(&m->loaded_filepaths, index);
+}
+
+bool ac_manager_get_include(ac_manager* m, strv dir, strv path, strv* result)
+{
+    ac_include_entry key = { .dir = dir, .path = path };
+    ac_include_entry* entry = ac_include_table_get_item_h(&m->includes, &key, include_hash(dir, path));
+    if (entry)
+    {
+        *result = entry->result;
+    }
+    return entry != NULL;
+}
+
+void ac_manager_set_include(ac_manager* m, strv dir, strv path, strv result)
+{
+    /* 'path' comes from a token and 'dir' from the including file, both are copied since the entry can outlive them.
+       They are not interned, the entries are dropped with the preprocessor memory. */
+    ac_include_entry entry;
+    entry.dir = copy_to_preprocessor_arena(m, dir);
+    entry.path = copy_to_preprocessor_arena(m, path);
+    entry.result = result.size ? allocate_filepath(m, result.data) : strv_make();
+    entry.hash = include_hash(dir, path);
+    ac_include_table_insert_h(&m->includes, &entry, entry.hash);
+}
+
+void ac_manager_reserve_for_input(ac_manager* m, size_t byte_count)
+{
+    /* Measured on the headers of /usr/include: one new identifier every 24 to 116 bytes depending
+       on the files, one new literal every 500 to 1500 bytes. The denser ratios are used. */
+    ac_ident_table_reserve(&m->identifiers, byte_count / IDENTIFIER_BYTE_RATIO);
+    ac_string_table_reserve(&m->literals, byte_count / LITERAL_BYTE_RATIO);
+}
+
+void ac_manager_release_preprocessor_memory(ac_manager* m)
+{
+    /* Identifiers still cache their last macro, they must not be used by a preprocessor anymore. */
+    darrT_destroy(&m->macros);
+    darrT_init(&m->macros);
+    ac_allocator_arena_destroy(&m->preprocessor_arena);
+    ac_allocator_arena_destroy(&m->macro_map_arena);
+    init_preprocessor_arenas(m, m->options->arenas);
+    m->has_predefined_macros = false;
+
+    ac_include_table_destroy(&m->includes);
+    ac_include_table_init(&m->includes);
+
+    for (size_t i = 0; i < m->opened_files.capacity; i += 1)
+    {
+        if (m->opened_files.ctrl[i] != SWISST_EMPTY)
+        {
+            release_source_pages(&m->opened_files.slots[i]);
+        }
+    }
+}
+
+void ac_manager_print_memory_report(ac_manager* m, FILE* file)
+{
+    fprintf(file, "%-20s %12s %12s %8s\n", "arena", "used", "reserved", "chunks");
+    print_arena_usage(file, "ast_arena", &m->ast_arena);
+    print_arena_usage(file, "identifiers_arena", &m->identifiers_arena);
+    print_arena_usage(file, "strings_arena", &m->strings_arena);
+    print_arena_usage(file, "preprocessor_arena", &m->preprocessor_arena);
+    print_arena_usage(file, "macro_map_arena", &m->macro_map_arena);
+
+    fprintf(file, "\n%-20s %12s %12s %8s %12s %12s\n", "table", "count", "buckets", "load", "avg displ.", "max displ.");
+    ht_size_t displacement, max_displacement;
+    ac_ident_table_get_displacement(&m->identifiers, &displacement, &max_displacement);
+    print_table_usage(file, "identifiers", ac_ident_table_size(&m->identifiers), ac_ident_table_capacity(&m->identifiers), displacement, max_displacement);
+    ac_string_table_get_displacement(&m->literals, &displacement, &max_displacement);
+    print_table_usage(file, "literals", ac_string_table_size(&m->literals), ac_string_table_capacity(&m->literals), displacement, max_displacement);
+
+    /* Macros and their definitions are allocated in the macros arena. */
+    size_t macro_bytes, macro_reserved, macro_chunks;
+    ac_allocator_arena_usage(&m->preprocessor_arena, &macro_bytes, &macro_reserved, &macro_chunks);
+    size_t map_bytes, map_reserved, map_chunks;
+    ac_allocator_arena_usage(&m->macro_map_arena, &map_bytes, &map_reserved, &map_chunks);
+
+    fprintf(file, "\n%-20s %12zu\n", "macros", darrT_size(&m->macros));
+    fprintf(file, "%-20s %12zu\n", "macro bytes", macro_bytes + map_bytes);
+
+    static const char* source_names[ac_malloc_source_COUNT] = { "darr", "dstr", "ht", "arena" };
+    ac_malloc_traffic total = {0};
+
+    fprintf(file, "\n%-20s %12s %12s %12s\n", "malloc", "allocations", "bytes", "frees");
+    for (int i = 0; i < ac_malloc_source_COUNT; i += 1)
+    {
+        ac_malloc_traffic t = ac_malloc_traffic_of((enum ac_malloc_source)i);
+        fprintf(file, "%-20s %12zu %12zu %12zu\n", source_names[i], t.allocation_count, t.allocated_bytes, t.free_count);
+        total.allocation_count += t.allocation_count;
+        total.allocated_bytes += t.allocated_bytes;
+        total.free_count += t.free_count;
+    }
+    fprintf(file, "%-20s %12zu %12zu %12zu\n", "total", total.allocation_count, total.allocated_bytes, total.free_count);
+
+    fprintf(file, "\n%-20s %12zu\n", "peak rss", ac_peak_rss());
+}
+
 ac_ident_holder ac_create_or_reuse_identifier(ac_manager* m, strv ident)
 {
     return ac_create_or_reuse_identifier_h(m, ident, ac_hash((char*)ident.data, ident.size));
@@ -183,25 +359,37 @@ ac_ident_holder ac_create_or_reuse_identifier_h(ac_manager* m, strv ident_text,
 {
     ac_ident i;
     i.text = ident_text;
+    i.hash = hash;
     ac_ident_holder ident_to_find = {&i};
-    ac_ident_holder* result_ident = (ac_ident_holder*)ht_get_item_h(&m->identifiers, &ident_to_find, hash);
+    ac_ident_holder* result_ident = ac_ident_table_get_item_h(&m->identifiers, &ident_to_find, hash);
 
     /* If the identifier is new, a new entry is created. */
     if (result_ident == NULL)
     {
-        ac_ident* i = ac_allocator_allocate(&m->identifiers_arena.allocator, sizeof(ac_ident));
-        memset(i, 0, sizeof(ac_ident));
-
-        i->text.data = ac_allocator_allocate(&m->identifiers_arena.allocator, ident_text.size);
-        memcpy((char*)i->text.data, ident_text.data, ident_text.size);
-
-        i->text.size = ident_text.size;
+        AC_STATS_ADD(intern_miss_count, 1);
+        /* The text directly follows the identifier, the comparisons and the printing read the same cache lines. */
+        size_t inline_size = m->shared_strings ? 0 : ident_text.size;
+        ac_ident* i = ac_allocator_arena_allocate_aligned(&m->identifiers_arena, sizeof(ac_ident) + inline_size, sizeof(void*));
+        if (m->shared_strings)
+        {
+            i->text = ac_intern_table_get_or_add(m->shared_strings, ident_text, hash);
+        }
+        else
+        {
+            memcpy(i + 1, ident_text.data, ident_text.size);
+            i->text = strv_make_from((const char*)(i + 1), ident_text.size);
+        }
+        i->hash = hash;
+        i->macro = NULL;
+        i->macro_generation = 0;
+        i->cannot_expand = false;
         ac_ident_holder holder = { .ident = i, .token_type = ac_token_type_IDENTIFIER };
-        ht_insert_h(&m->identifiers, &holder, hash);
+        ac_ident_table_insert_h(&m->identifiers, &holder, hash);
         return holder;
     }
     else
     {
+        AC_STATS_ADD(intern_hit_count, 1);
         return *result_ident;
     }
 }
@@ -209,9 +397,9 @@ ac_ident_holder ac_create_or_reuse_identifier_h(ac_manager* m, strv ident_text,
 void ac_register_known_identifier(ac_manager* m, ac_ident* id, /* enum ac_token_type */ size_t token_type)
 {
     ac_ident_holder holder = { .ident = id, .token_type = token_type };
-  
-    ht_hash_t h = ac_hash((char*)id->text.data, id->text.size);
-    ht_insert_h(&m->identifiers, &holder, h);
+
+    id->hash = ac_hash((char*)id->text.data, id->text.size);
+    ac_ident_table_insert_h(&m->identifiers, &holder, id->hash);
 }
 
 strv ac_create_or_reuse_literal(ac_manager* m, strv literal_text)
@@ -221,24 +409,53 @@ strv ac_create_or_reuse_literal(ac_manager* m, strv literal_text)
 
 strv ac_create_or_reuse_literal_h(ac_manager* m, strv literal_text, size_t hash)
 {
-    strv* result_literal = (strv*)ht_get_item_h(&m->literals, &literal_text, hash);
+    ac_string_entry entry;
+    entry.text = literal_text;
+    entry.hash = hash;
+    ac_string_entry* result_literal = ac_string_table_get_item_h(&m->literals, &entry, hash);
 
     /* If the identifier is new, a new entry is created. */
     if (result_literal == NULL)
     {
-        strv v;
-        v.data = (const char*)ac_allocator_allocate(&m->identifiers_arena.allocator, literal_text.size);
-        memcpy((char*)v.data, literal_text.data, literal_text.size);
-        v.size = literal_text.size;
-        ht_insert_h(&m->literals, &v, hash);
-        return v;
+        entry.text = intern_text(m, literal_text, hash);
+        ac_string_table_insert_h(&m->literals, &entry, hash);
+        return entry.text;
     }
     else
     {
-        return *result_literal;
+        return result_literal->text;
     }
 }
 
+static strv intern_text(ac_manager* m, strv text, size_t hash)
+{
+    if (m->shared_strings)
+    {
+        return ac_intern_table_get_or_add(m->shared_strings, text, hash);
+    }
+
+    strv v;
+    v.data = (const char*)ac_allocator_arena_allocate_bytes(&m->strings_arena, text.size);
+    if (text.size)
+    {
+        memcpy((char*)v.data, text.data, text.size);
+    }
+    v.size = text.size;
+    return v;
+}
+
+static strv copy_to_preprocessor_arena(ac_manager* m, strv text)
+{
+    strv v;
+    v.data = (const char*)ac_allocator_arena_allocate_bytes(&m->preprocessor_arena, text.size);
+    if (text.size)
+    {
+        memcpy((char*)v.data, text.data, text.size);
+    }
+    v.size = text.size;
+    return v;
+}
+
 static bool load_source_file(ac_manager* m, char* filepath, source_file* result)
 {
     if (!re_file_exists_str(filepath))
@@ -254,7 +471,7 @@ static bool load_source_file(ac_manager* m, char* filepath, source_file* result)
         return false;
     }
     
-    darr_map_set(&m->opened_files, result);
+    ac_file_table_insert(&m->opened_files, result);
 
     return true;
 }
@@ -262,11 +479,26 @@ static bool load_source_file(ac_manager* m, char* filepath, source_file* result)
 static strv allocate_filepath(ac_manager* m, const char* filepath)
 {
     size_t filepath_size = strlen(filepath);
-    void* filepath_memory = ac_allocator_allocate(&m->identifiers_arena.allocator, filepath_size + 1); /* +1 for null-termating char. */
-    strncpy(filepath_memory, filepath, filepath_size);
+    char* filepath_memory = ac_allocator_arena_allocate_bytes(&m->strings_arena, filepath_size + 1); /* +1 for null-termating char. */
+    memcpy(filepath_memory, filepath, filepath_size);
+    filepath_memory[filepath_size] = '\0';
     return strv_make_from(filepath_memory, filepath_size);
 }
 
+static void init_preprocessor_arenas(ac_manager* m, enum ac_arena_kind kind)
+{
+    ac_allocator_arena_init_kind(&m->preprocessor_arena, kind, (size_t)1 << 30);
+    ac_allocator_arena_init(&m->macro_map_arena, 16 * 1024);
+}
+
+static ac_file_entry* allocate_file_entry(ac_manager* m)
+{
+    /* Identifiers with their inline text have any size, the entry must be aligned. */
+    ac_file_entry* entry = ac_allocator_arena_allocate_aligned(&m->identifiers_arena, sizeof(ac_file_entry), AC_ALIGNOF(ac_file_entry));
+    memset(entry, 0, sizeof(ac_file_entry));
+    return entry;
+}
+
 #ifdef _WIN32
 static int convert_utf8_to_wchar(ac_manager* m, const char* chars)
 {
@@ -323,12 +555,16 @@ static bool mmap_or_get_source_file(ac_manager* m, source_file* src_file, const
     };
 
     /* Retrieve the content if it's already opened. */
-    if (darr_map_get(&m->opened_files, &lookup, src_file))
+    source_file* opened = ac_file_table_get_item(&m->opened_files, &lookup);
+    if (opened)
     {
+        *src_file = *opened;
+        CloseHandle(handle); /* The handle of the already opened file is kept instead. */
         return true;
     }
 
     src_file->filepath = allocate_filepath(m, filepath);
+    src_file->entry = allocate_file_entry(m);
 
     src_file->handle = handle;
     src_file->info = info;
@@ -389,12 +625,16 @@ static bool mmap_or_get_source_file(ac_manager* m, source_file* src_file, const
     };
 
     /* Retrieve the content if it's already opened. */
-    if (darr_map_get(&m->opened_files, &lookup, src_file))
+    source_file* opened = ac_file_table_get_item(&m->opened_files, &lookup);
+    if (opened)
     {
+        *src_file = *opened;
+        close(fd); /* The descriptor of the already opened file is kept instead. */
         return true;
     }
 
     src_file->filepath = allocate_filepath(m, filepath);
+    src_file->entry = allocate_file_entry(m);
 
     /* Handle zero size file as it would make mmap to fail. */
     if (st.st_size == 0)
@@ -439,50 +679,58 @@ static bool unmap_source_file(source_file* source_file)
 #endif
 }
 
-static darr_bool source_file_less_predicate(source_file* left, source_file* right)
+static void release_source_pages(source_file* source_file)
 {
+    if (source_file->content.size == 0)
+    {
+        return;
+    }
 #if _WIN32
-    return memcmp(&left->info, &right->info, sizeof(left->info)) < 0;
+    /* Unlocking pages which are not locked removes them from the working set. */
+    VirtualUnlock((void*)source_file->content.data, source_file->content.size);
 #else
-    return left->st.st_dev < right->st.st_dev
-        || left->st.st_ino < right->st.st_ino
-        || left->st.st_size < right->st.st_size
-        || left->st.st_mtime < right->st.st_mtime;
+    /* The mapping is shared and read-only, the pages are read again from the file if they are accessed. */
+    madvise((void*)source_file->content.data, source_file->content.size, MADV_DONTNEED);
 #endif
 }
 
-static ht_hash_t identifier_hash(ac_ident_holder* i)
+static size_t source_file_hash(const source_file* f)
 {
-    return ac_hash((char*)i->ident->text.data, i->ident->text.size);
+#if _WIN32
+    return ac_hash((char*)&f->info, sizeof(f->info));
+#else
+    size_t identity[4] = { (size_t)f->st.st_dev, (size_t)f->st.st_ino, (size_t)f->st.st_size, (size_t)f->st.st_mtime };
+    return ac_hash((char*)identity, sizeof(identity));
+#endif
 }
 
-static ht_bool identifiers_are_same(ac_ident_holder* left, ac_ident_holder* right)
+static bool source_files_are_same(const source_file* left, const source_file* right)
 {
-    return strv_equals(left->ident->text, right->ident->text);
+#if _WIN32
+    return memcmp(&left->info, &right->info, sizeof(left->info)) == 0;
+#else
+    return left->st.st_dev == right->st.st_dev
+        && left->st.st_ino == right->st.st_ino
+        && left->st.st_size == right->st.st_size
+        && left->st.st_mtime == right->st.st_mtime;
+#endif
 }
 
-static void swap_identifiers(ac_ident_holder* left, ac_ident_holder* right)
+static size_t include_hash(strv dir, strv path)
 {
-    ac_ident_holder tmp;
-    tmp = *left;
-    *left = *right;
-    *right = tmp;
+    return ac_hash((char*)path.data, path.size) * 31 + ac_hash((char*)dir.data, dir.size);
 }
 
-static ht_hash_t literal_hash(strv* literal)
+static void print_arena_usage(FILE* file, const char* name, ac_allocator_arena* a)
 {
-    return ac_hash((char*)literal->data, literal->size);
+    size_t used, reserved, chunk_count;
+    ac_allocator_arena_usage(a, &used, &reserved, &chunk_count);
+    fprintf(file, "%-20s %12zu %12zu %8zu\n", name, used, reserved, chunk_count);
 }
 
-static ht_bool literals_are_same(strv* left, strv* right)
+static void print_table_usage(FILE* file, const char* name, size_t count, size_t bucket_count, size_t total_displacement, size_t max_displacement)
 {
-    return strv_equals(*left, *right);
+    double load = bucket_count ? (double)count / (double)bucket_count : 0.0;
+    double average = count ? (double)total_displacement / (double)count : 0.0;
+    fprintf(file, "%-20s %12zu %12zu %8.2f %12.2f %12zu\n", name, count, bucket_count, load, average, max_displacement);
 }
-
-static void swap_literals(strv* left, strv* right)
-{
-    strv tmp;
-    tmp = *left;
-    *left = *right;
-    *right = tmp;
-}
\ No newline at end of file
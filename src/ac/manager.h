@@ -5,6 +5,8 @@
 
 #include "alloc.h"
 #include "global.h"
+#include "intern.h"
+#include "macro_map.h"
 #include "re_lib.h"
 
 #ifdef __cplusplus
@@ -12,12 +14,42 @@ extern "C" {
 #endif
 
 typedef struct ac_ident ac_ident;
+typedef struct ac_macro ac_macro;
 typedef struct ac_ast_top_level ac_ast_top_level;
 
+/* Location and kind of a directive line. */
+typedef struct ac_directive ac_directive;
+struct ac_directive {
+    /* enum ac_token_type */ int type; /* Type of the directive name, ac_token_type_NEW_LINE for the null directive. */
+    size_t offset;  /* Byte offset of the '#' in the file content. */
+    int row;        /* Location of the '#' as seen by a lexer starting at the beginning of the file. */
+    int col;
+    int pos;
+    size_t partner; /* For #if/#elif/#else: index of the next #elif/#else/#endif of the same level, (size_t)-1 otherwise. */
+};
+
+/* All directives of a file, built the first time a block of a re-included file is skipped.
+   It allows to jump over a skipped block instead of scanning it again. */
+typedef struct ac_directive_index ac_directive_index;
+struct ac_directive_index {
+    bool is_built;
+    bool is_valid;        /* False if the conditional directives are not balanced. */
+    ac_directive* items;  /* Sorted by offset. Allocated in the identifiers arena. */
+    size_t count;
+};
+
+/* Data shared by all the inclusions of the same file. */
+typedef struct ac_file_entry ac_file_entry;
+struct ac_file_entry {
+    int load_count; /* Number of times the file content has been requested. */
+    ac_directive_index directives;
+};
+
 typedef struct ac_source_file ac_source_file;
 struct ac_source_file {
     strv filepath; /* NOTE: View to a null terminated string. */
     strv content;  /* NOTE: View to a null terminated string. */
+    ac_file_entry* entry;
 };
 
 /* options */
@@ -31,6 +63,11 @@ enum ac_compilation_step {
     ac_compilation_step_ALL = ~0,
 };
 
+enum ac_deps_format {
+    ac_deps_format_MAKE, /* Make rule like "gcc -M". */
+    ac_deps_format_JSON,
+};
+
 typedef struct ac_options ac_options;
 struct ac_options {
 
@@ -52,6 +89,16 @@ struct ac_options {
     bool preprocess_benchmark;           /* Preprocess only without printing the result in the standard output. */
     bool preserve_comment;               /* Also print comments while preprocessing. */
     bool reject_hex_float;               /* Prevent hex float parsing. */
+    const char* emit_pch;                /* Preprocess the file and save the resulting macros into this precompiled header. */
+    const char* include_pch;             /* Precompiled header to load before preprocessing. */
+    bool scan_deps;                      /* Print the files included by the source file, only directives are processed. */
+    enum ac_deps_format deps_format;     /* Output format of scan_deps. */
+    const char* profile_preprocessor;    /* Profile macros and included files, the report is written as JSON in this file. */
+    bool memory_report;                  /* Print the memory used by the compilation. */
+    bool stats;                          /* Print the hot path counters, the compiler must be built with AC_STATS. */
+    const char* trace;                   /* Record the phases of the compilation, the timeline is written in this file. */
+    size_t jobs;                         /* Threads compiling multiple files, 0 for the number of cores. */
+    enum ac_arena_kind arenas;           /* Kind of the ast and identifiers arenas. */
   
     path_array user_includes;            /* User include directories. Equivalent of GCC -I. */
     path_array system_includes;          /* System include directories. Equivalent of GCC -isystem. */
@@ -62,24 +109,72 @@ void ac_options_destroy(ac_options* o);
 
 /* manager */
 
+typedef struct ac_ident_holder ac_ident_holder;
+struct ac_ident_holder
+{
+    ac_ident* ident;
+    /* enum ac_token_type */ size_t token_type;
+};
+
+/* Table of the identifiers of a manager, its functions are defined in lexer.h with ac_ident. */
+SWISST_DECLARE(ac_ident_table, ac_ident_holder)
+
+/* Result of the search of an #include path from the directory of the including file. */
+typedef struct ac_include_entry ac_include_entry;
+struct ac_include_entry {
+    strv dir;    /* Directory of the including file, empty for absolute paths. */
+    strv path;   /* Path written in the directive. */
+    strv result; /* Null-terminated path of the file found, empty if it was not found. */
+    size_t hash;
+};
+SWISST_DECLARE(ac_include_table, ac_include_entry)
+
+/* Tables of the files, their items are defined in manager.c. */
+SWISST_DECLARE(ac_file_table, struct source_file)
+SWISST_DECLARE(ac_path_table, struct ac_loaded_path)
+
 typedef struct ac_manager ac_manager;
 struct ac_manager {
     ac_options* options;
 
-    /* Arena allocator to create new ast-related objects.
+    /* Arena allocator to create the nodes of the AST, nothing else.
        They are freed when the managed is destroyed. */
     ac_allocator_arena ast_arena;
 
     /* Arena allocator to create identifier and unique string.
        They are freed when the managed is destroyed. */
     ac_allocator_arena identifiers_arena;
-
-    ht identifiers; /* Hash table with all identifiers to compare them faster with a hash. */
-    ht literals;    /* Hash table with all literals to compare them faster with a hash. */
+    /* Text of the literals and the paths, packed without alignment nor padding. */
+    ac_allocator_arena strings_arena;
+
+    ac_ident_table identifiers; /* Hash table with all identifiers to compare them faster with a hash. */
+    ac_string_table literals;   /* Hash table with all literals to compare them faster with a hash. */
+    /* Text of the new identifiers and literals is taken from this table when managers on other threads share it,
+       NULL to copy it in the arenas. The tables above are still used first, they don't need any lock. */
+    ac_intern_table* shared_strings;
     ac_ast_top_level* top_level;
 
-    /* Map (lookup) of all opened (mmapped) files. */
-    darr_map opened_files;
+    /* All opened (mmapped) files, found from the identity of the file. */
+    ac_file_table opened_files;
+    /* Opened files found from the path used to load them, to not open and stat the same path again. */
+    ac_path_table loaded_paths;
+    /* Searches of #include paths, they are done once for each directory of the including files. */
+    ac_include_table includes;
+    darrT(strv) loaded_filepaths; /* Path of each opened file in the order they were first loaded. */
+
+    /* All macros created by the preprocessors. They are destroyed with the manager, or once the AST is parsed,
+       so that any version of a macro map remains valid while the preprocessors run. */
+    darrT(ac_macro*) macros;
+    /* Macros, their definitions and the other states of the preprocessors that outlive a directive.
+       Each definition is allocated with its exact size. Released once the AST is parsed. */
+    ac_allocator_arena preprocessor_arena;
+    /* Arena allocator for the nodes of the macro maps. */
+    ac_allocator_arena macro_map_arena;
+    size_t macro_generation; /* Last generation given to a preprocessor, see ac_ident::macro_generation. */
+
+    /* Macros defined by the predefines, they are only processed by the first preprocessor. */
+    bool has_predefined_macros;
+    ac_macro_map predefined_macros;
 
 #ifdef _WIN32
     darrT(wchar_t) wchars;
@@ -91,12 +186,28 @@ void ac_manager_destroy(ac_manager* m);
 
 bool ac_manager_load_content(ac_manager* m, char* filepath, ac_source_file* src_file);
 
-typedef struct ac_ident_holder ac_ident_holder;
-struct ac_ident_holder
-{
-    ac_ident* ident;
-    /* enum ac_token_type */ size_t token_type;
-};
+/* Get the result of a previous search of '#include path' from 'dir', returns false if there was none.
+   'result' is empty if the file was not found. */
+bool ac_manager_get_include(ac_manager* m, strv dir, strv path, strv* result);
+/* Keep the result of the search of '#include path' from 'dir', an empty 'result' if the file was not found. */
+void ac_manager_set_include(ac_manager* m, strv dir, strv path, strv result);
+
+/* Size the identifier and literal tables for 'byte_count' bytes of input, to avoid growing them while lexing. */
+void ac_manager_reserve_for_input(ac_manager* m, size_t byte_count);
+
+/* Number of different files loaded with ac_manager_load_content. */
+size_t ac_manager_loaded_file_count(ac_manager* m);
+/* Path of a loaded file in loading order, 'index' must be lower than ac_manager_loaded_file_count. */
+strv ac_manager_loaded_filepath(ac_manager* m, size_t index);
+
+/* Release the memory only used by the preprocessors once the AST is parsed: macros, macro maps,
+   searches of #include paths and the resident pages of the source files.
+   The locations of the AST still view the content of the files, the pages are read again if needed. */
+void ac_manager_release_preprocessor_memory(ac_manager* m);
+
+/* Print the memory held by the arenas, hash tables and macros, and the malloc traffic of the current thread. */
+void ac_manager_print_memory_report(ac_manager* m, FILE* file);
+
 /* NOTE: An ac_token is returned as result simply because we want a string view and a token type. */
 ac_ident_holder ac_create_or_reuse_identifier(ac_manager* m, strv ident_text);
 ac_ident_holder ac_create_or_reuse_identifier_h(ac_manager* m, strv ident_text, size_t hash);
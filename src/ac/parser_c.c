@@ -6,15 +6,16 @@
 
 #define CAST(type_, object_) (type_)(object_)
 
+/* Nodes without constructor are zeroed, the constructors initialize all the fields of their node. */
 #define AST_NEW(p, type_, ident_, location_, ast_type_) \
-        type_* ident_ = (type_*)allocate(p, sizeof(type_)); \
+        type_* ident_ = ac_arena_new_zero(&(p)->mgr->ast_arena, type_); \
         do { \
             ident_->type = ast_type_; \
             ident_->loc = location_; \
         } while (0);
 
 #define AST_NEW_CTOR(p, type_, ident_, location_, constructor_) \
-        type_* ident_ = (type_*)allocate(p, sizeof(type_)); \
+        type_* ident_ = ac_arena_new(&(p)->mgr->ast_arena, type_); \
         do { \
             constructor_(ident_); \
             ident_->loc = location_; \
@@ -26,7 +27,6 @@ static int LOWEST_PRIORITY_PRECEDENCE = 999;
 
 typedef bool (*ensure_expr_t)(ac_ast_expr* expr);
 
-static void* allocate(ac_parser_c * p, size_t byte_size);
 static ac_options* options(ac_parser_c* p);
 
 static ac_ast_top_level* parse_top_level(ac_parser_c* p);
@@ -105,11 +105,6 @@ bool ac_parser_c_parse(ac_parser_c* p)
     return top_level != 0;
 }
 
-static void* allocate(ac_parser_c* p, size_t byte_size)
-{
-    return ac_allocator_allocate(&p->mgr->ast_arena.allocator, byte_size);
-}
-
 static ac_options* options(ac_parser_c* p)
 {
     return p->mgr->options;
@@ -1040,13 +1035,14 @@ static bool is_leading_declaration(enum ac_token_type type)
         ;
 }
 
+/* The current token is the one returned by the preprocessor, it can come from a macro expansion or a precompiled header. */
 static ac_token token(const ac_parser_c* p)
 {
-    return p->pp.lex.token;
+    return *p->pp.current_token;
 }
 static const ac_token* token_ptr(const ac_parser_c* p)
 {
-    return &p->pp.lex.token;
+    return p->pp.current_token;
 }
 static ac_location location(const ac_parser_c* p)
 {
@@ -1070,11 +1066,11 @@ static void goto_next_token(ac_parser_c* p)
 
 static enum ac_token_type token_type(const ac_parser_c* p)
 {
-    return p->pp.lex.token.type;
+    return token_ptr(p)->type;
 }
 
 static bool token_is(const ac_parser_c* p, enum ac_token_type type) {
-    return token_equal_type(p->pp.lex.token, type);
+    return token_equal_type(token(p), type);
 }
 
 static bool token_is_not(const ac_parser_c* p, enum ac_token_type type)
@@ -1084,7 +1080,7 @@ static bool token_is_not(const ac_parser_c* p, enum ac_token_type type)
 
 static bool token_is_unary_operator(const ac_parser_c* p)
 {
-    switch (p->pp.lex.token.type) {
+    switch (token_type(p)) {
     case ac_token_type_AMP:
     case ac_token_type_DOT:
     case ac_token_type_EXCLAM:
@@ -1103,7 +1099,19 @@ static bool token_equal_type(ac_token token, enum ac_token_type type)
 }
 
 static bool expect(ac_parser_c* p, enum ac_token_type type) {
-    return ac_lex_expect(&p->pp.lex, type);
+    if (token_type(p) != type)
+    {
+        strv expected = ac_token_type_to_strv(type);
+        strv actual = ac_token_to_strv(token(p));
+
+        ac_report_error_loc(location(p), "syntax error: expected '%.*s', actual '%.*s'"
+            , expected.size, expected.data
+            , actual.size, actual.data
+        );
+
+        return false;
+    }
+    return true;
 }
 
 static bool expect_and_consume(ac_parser_c* p, enum ac_token_type type)
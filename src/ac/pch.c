@@ -0,0 +1,569 @@
+#include "pch.h"
+
+#include <stdlib.h>   /* qsort */
+#include <sys/stat.h> /* stat */
+
+#include "re/file.h"
+#include "re/path.h"
+
+#include "global.h"
+#include "lexer.h"
+
+/*
+    Layout of a precompiled header, all sections are 8-byte aligned and use the native layout:
+
+        header
+        files[file_count]       Absolute paths of the files loaded to produce the macros.
+        strings[string_count]   Offset and size of the strings in the blob. Identifiers come first.
+        macros[macro_count]
+        tokens[token_count]     Tokens of all macro definitions, then the tokens produced by the prelude.
+        blob[blob_size]         Null-terminated strings.
+
+    Tokens are stored as is except for their identifier or text which is replaced with a string index.
+    The tokens produced by the prelude (declarations, prototypes, etc.) are replayed before the ones of the file
+    including the precompiled header, since the include guards restored with the macros would skip them.
+    Since ac_token is stored verbatim a precompiled header can only be read by the same build of ac.
+*/
+
+#define PCH_MAGIC "ACPCH02"
+
+/* Value stored in the text of a token which had no text. */
+#define NO_STRING ((uint64_t)-1)
+
+typedef struct pch_header pch_header;
+struct pch_header {
+    char magic[8];
+    uint64_t token_size;
+    uint64_t file_count;
+    uint64_t identifier_count;
+    uint64_t string_count;
+    uint64_t macro_count;
+    uint64_t token_count;
+    uint64_t output_first_token; /* Tokens produced by the prelude. */
+    uint64_t output_token_count;
+    uint64_t blob_size;
+    int64_t counter_value;
+};
+
+typedef struct pch_file pch_file;
+struct pch_file {
+    uint64_t path; /* String index. */
+    uint64_t size;
+    int64_t mtime;
+};
+
+typedef struct pch_string pch_string;
+struct pch_string {
+    uint64_t offset;
+    uint64_t size;
+};
+
+typedef struct pch_macro pch_macro;
+struct pch_macro {
+    uint64_t name; /* Identifier index. */
+    uint64_t first_token;
+    uint64_t token_count;
+    uint64_t params_start;
+    uint64_t params_end;
+    uint64_t body_start;
+    uint64_t body_end;
+    uint64_t filepath; /* String index. */
+    int32_t row;
+    int32_t col;
+    int32_t pos;
+    int32_t is_function_like;
+};
+
+typedef struct pch_writer pch_writer;
+struct pch_writer {
+    darrT(ac_ident*) identifiers; /* Sorted to retrieve their index with a binary search. */
+    darrT(pch_file) files;
+    darrT(pch_string) strings;
+    darrT(pch_macro) macros;
+    darrT(ac_token) tokens;
+    dstr blob;
+};
+
+static void writer_init(pch_writer* w);
+static void writer_destroy(pch_writer* w);
+static int compare_pointers(const void* left, const void* right);
+/* Push the identifiers of the tokens, they are sorted by collect_identifiers. */
+static void push_identifiers(pch_writer* w, const ac_token* tokens, size_t count);
+/* Collect the identifiers of the macros and the output, including the ones from the macro definitions. */
+static void collect_identifiers(pch_writer* w, ac_macro** macros, size_t count, const ac_token* output, size_t output_count);
+static uint64_t identifier_index(pch_writer* w, ac_ident* ident);
+static uint64_t add_string(pch_writer* w, strv text);
+/* Add the tokens and return the index of the first one. */
+static uint64_t add_tokens(pch_writer* w, const ac_token* tokens, size_t count);
+static void add_macro(pch_writer* w, ac_macro* m);
+static bool write_section(FILE* file, const void* data, size_t size);
+
+/* Get size and modification time of a file. */
+static bool file_status(const char* filepath, uint64_t* size, int64_t* mtime);
+/* Check that the section [offset, offset + count * size) is inside the content. */
+static bool section_fits(strv content, size_t* offset, uint64_t count, size_t size);
+/* Replace the string index of the token with its identifier or its text, return false if the index is invalid. */
+static bool read_token(ac_manager* mgr, const pch_header* h, const pch_string* strings, const char* blob, ac_ident** identifiers, ac_token* t);
+static bool report_invalid(const char* filepath);
+
+bool ac_pch_save(ac_pp* pp, const char* filepath, const ac_token* output, size_t output_count)
+{
+    ac_manager* mgr = pp->mgr;
+
+    /* Only keep the macros which are still defined. */
+    darrT(ac_macro*) live;
+    darrT_init(&live);
+    for (size_t i = 0; i < darrT_size(&mgr->macros); i += 1)
+    {
+        ac_macro* m = darrT_at(&mgr->macros, i);
+        if (ac_macro_map_get(&pp->macro_map, m->ident) == m)
+        {
+            darrT_push_back(&live, m);
+        }
+    }
+
+    pch_writer w;
+    writer_init(&w);
+
+    collect_identifiers(&w, darrT_ptr(&live, 0), darrT_size(&live), output, output_count);
+    for (size_t i = 0; i < darrT_size(&w.identifiers); i += 1)
+    {
+        add_string(&w, darrT_at(&w.identifiers, i)->text);
+    }
+
+    size_t identifier_count = darrT_size(&w.identifiers);
+
+    /* Paths are made absolute so the precompiled header can be used from any directory. */
+    dstr path;
+    dstr_init(&path);
+    for (size_t i = 0; i < ac_manager_loaded_file_count(mgr); i += 1)
+    {
+        dstr_assign(&path, ac_manager_loaded_filepath(mgr, i));
+        re_path_get_absolute(&path);
+        pch_file f = { 0 };
+        if (!file_status(path.data, &f.size, &f.mtime))
+        {
+            ac_report_error("could not get the status of '%s'", path.data);
+            dstr_destroy(&path);
+            darrT_destroy(&live);
+            writer_destroy(&w);
+            return false;
+        }
+        f.path = add_string(&w, dstr_to_strv(&path));
+        darrT_push_back(&w.files, f);
+    }
+    dstr_destroy(&path);
+
+    for (size_t i = 0; i < darrT_size(&live); i += 1)
+    {
+        add_macro(&w, darrT_at(&live, i));
+    }
+
+    uint64_t output_first_token = add_tokens(&w, output, output_count);
+
+    pch_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PCH_MAGIC, sizeof(PCH_MAGIC));
+    h.token_size = sizeof(ac_token);
+    h.file_count = darrT_size(&w.files);
+    h.identifier_count = identifier_count;
+    h.string_count = darrT_size(&w.strings);
+    h.macro_count = darrT_size(&w.macros);
+    h.token_count = darrT_size(&w.tokens);
+    h.output_first_token = output_first_token;
+    h.output_token_count = output_count;
+    h.blob_size = w.blob.size;
+    h.counter_value = pp->counter_value;
+
+    bool result = false;
+    FILE* file = re_file_open(filepath, "wb");
+    if (!file)
+    {
+        ac_report_error("could not open '%s' for writing", filepath);
+    }
+    else
+    {
+        result = write_section(file, &h, sizeof(h))
+            && write_section(file, darrT_ptr(&w.files, 0), sizeof(pch_file) * h.file_count)
+            && write_section(file, darrT_ptr(&w.strings, 0), sizeof(pch_string) * h.string_count)
+            && write_section(file, darrT_ptr(&w.macros, 0), sizeof(pch_macro) * h.macro_count)
+            && write_section(file, darrT_ptr(&w.tokens, 0), sizeof(ac_token) * h.token_count)
+            && write_section(file, w.blob.data, h.blob_size);
+
+        re_file_close(file);
+
+        if (!result)
+        {
+            ac_report_error("could not write precompiled header '%s'", filepath);
+        }
+    }
+
+    darrT_destroy(&live);
+    writer_destroy(&w);
+    return result;
+}
+
+bool ac_pch_load(ac_pp* pp, const char* filepath)
+{
+    ac_manager* mgr = pp->mgr;
+
+    ac_source_file src_file;
+    if (!ac_manager_load_content(mgr, (char*)filepath, &src_file))
+    {
+        return false;
+    }
+
+    strv content = src_file.content;
+    size_t offset = 0;
+
+    pch_header h;
+    if (!section_fits(content, &offset, 1, sizeof(h)))
+    {
+        return report_invalid(filepath);
+    }
+    memcpy(&h, content.data, sizeof(h));
+
+    if (memcmp(h.magic, PCH_MAGIC, sizeof(PCH_MAGIC)) != 0
+        || h.token_size != sizeof(ac_token))
+    {
+        return report_invalid(filepath);
+    }
+
+    const pch_file* files = (const pch_file*)(content.data + offset);
+    if (!section_fits(content, &offset, h.file_count, sizeof(pch_file)))
+        return report_invalid(filepath);
+
+    const pch_string* strings = (const pch_string*)(content.data + offset);
+    if (!section_fits(content, &offset, h.string_count, sizeof(pch_string)))
+        return report_invalid(filepath);
+
+    const pch_macro* macros = (const pch_macro*)(content.data + offset);
+    if (!section_fits(content, &offset, h.macro_count, sizeof(pch_macro)))
+        return report_invalid(filepath);
+
+    const ac_token* tokens = (const ac_token*)(content.data + offset);
+    if (!section_fits(content, &offset, h.token_count, sizeof(ac_token)))
+        return report_invalid(filepath);
+
+    const char* blob = content.data + offset;
+    if (!section_fits(content, &offset, h.blob_size, 1)
+        || h.identifier_count > h.string_count)
+        return report_invalid(filepath);
+
+    /* Validate all strings once so that they can be used without further checks. */
+    for (uint64_t i = 0; i < h.string_count; i += 1)
+    {
+        if (strings[i].offset > h.blob_size
+            || strings[i].size >= h.blob_size - strings[i].offset
+            || blob[strings[i].offset + strings[i].size] != '\0')
+        {
+            return report_invalid(filepath);
+        }
+    }
+
+    /* Reject the precompiled header if any of its files changed. */
+    for (uint64_t i = 0; i < h.file_count; i += 1)
+    {
+        if (files[i].path >= h.string_count)
+            return report_invalid(filepath);
+
+        const char* path = blob + strings[files[i].path].offset;
+        uint64_t size;
+        int64_t mtime;
+        if (!file_status(path, &size, &mtime)
+            || size != files[i].size
+            || mtime != files[i].mtime)
+        {
+            ac_report_error("precompiled header '%s' is outdated: '%s' has changed", filepath, path);
+            return false;
+        }
+    }
+
+    /* Retrieve identifiers. */
+    ac_ident** identifiers = (ac_ident**)ac_arena_push(&mgr->preprocessor_arena, sizeof(ac_ident*) * (h.identifier_count + 1), AC_ALIGNOF(ac_ident*));
+    for (uint64_t i = 0; i < h.identifier_count; i += 1)
+    {
+        strv text = strv_make_from(blob + strings[i].offset, strings[i].size);
+        identifiers[i] = ac_create_or_reuse_identifier(mgr, text).ident;
+    }
+
+    /* Create macros. */
+    ac_macro_map map;
+    ac_macro_map_init(&map);
+
+    for (uint64_t i = 0; i < h.macro_count; i += 1)
+    {
+        const pch_macro* pm = macros + i;
+
+        if (pm->name >= h.identifier_count
+            || pm->filepath >= h.string_count
+            || pm->first_token > h.token_count
+            || pm->token_count > h.token_count - pm->first_token
+            || pm->params_start > pm->params_end || pm->params_end > pm->token_count
+            || pm->body_start > pm->body_end || pm->body_end > pm->token_count)
+        {
+            return report_invalid(filepath);
+        }
+
+        ac_macro* m = ac_arena_new(&mgr->preprocessor_arena, ac_macro);
+        darrT_push_back(&mgr->macros, m);
+
+        m->ident = identifiers[pm->name];
+        m->is_function_like = pm->is_function_like != 0;
+        m->params.start = pm->params_start;
+        m->params.end = pm->params_end;
+        m->body.start = pm->body_start;
+        m->body.end = pm->body_end;
+
+        m->location = ac_location_empty();
+        m->location.filepath = strv_make_from(blob + strings[pm->filepath].offset, strings[pm->filepath].size);
+        m->location.row = pm->row;
+        m->location.col = pm->col;
+        m->location.pos = pm->pos;
+
+        m->definition = (ac_token*)ac_arena_push(&mgr->preprocessor_arena, pm->token_count * sizeof(ac_token), AC_ALIGNOF(ac_token));
+        m->definition_count = pm->token_count;
+        for (uint64_t j = 0; j < pm->token_count; j += 1)
+        {
+            ac_token t = tokens[pm->first_token + j];
+            if (!read_token(mgr, &h, strings, blob, identifiers, &t))
+                return report_invalid(filepath);
+
+            m->definition[j] = t;
+        }
+
+        map = ac_macro_map_set(&map, &mgr->macro_map_arena.allocator, m->ident, m);
+    }
+
+    /* Replay the output of the prelude, it was already expanded when the precompiled header was created. */
+    if (h.output_first_token > h.token_count
+        || h.output_token_count > h.token_count - h.output_first_token)
+    {
+        return report_invalid(filepath);
+    }
+
+    ac_token* output = (ac_token*)ac_arena_push(&mgr->preprocessor_arena, h.output_token_count * sizeof(ac_token), AC_ALIGNOF(ac_token));
+    for (uint64_t i = 0; i < h.output_token_count; i += 1)
+    {
+        ac_token t = tokens[h.output_first_token + i];
+        if (!read_token(mgr, &h, strings, blob, identifiers, &t))
+            return report_invalid(filepath);
+
+        t.cannot_expand = true;
+        t.beginning_of_line = false; /* Never parsed as a directive. */
+        output[i] = t;
+    }
+
+    ac_pp_checkpoint c;
+    c.macros = map;
+    c.counter_value = (int)h.counter_value;
+    ac_pp_restore_checkpoint(pp, &c);
+
+    ac_pp_push_tokens(pp, output, h.output_token_count);
+
+    return true;
+}
+
+static void writer_init(pch_writer* w)
+{
+    darrT_init(&w->identifiers);
+    darrT_init(&w->files);
+    darrT_init(&w->strings);
+    darrT_init(&w->macros);
+    darrT_init(&w->tokens);
+    dstr_init(&w->blob);
+}
+
+static void writer_destroy(pch_writer* w)
+{
+    darrT_destroy(&w->identifiers);
+    darrT_destroy(&w->files);
+    darrT_destroy(&w->strings);
+    darrT_destroy(&w->macros);
+    darrT_destroy(&w->tokens);
+    dstr_destroy(&w->blob);
+}
+
+static int compare_pointers(const void* left, const void* right)
+{
+    uintptr_t l = (uintptr_t)*(void* const*)left;
+    uintptr_t r = (uintptr_t)*(void* const*)right;
+    return (l > r) - (l < r);
+}
+
+static void push_identifiers(pch_writer* w, const ac_token* tokens, size_t count)
+{
+    for (size_t i = 0; i < count; i += 1)
+    {
+        if (ac_token_is_keyword_or_identifier(tokens[i].type))
+        {
+            darrT_push_back(&w->identifiers, tokens[i].ident);
+        }
+    }
+}
+
+static void collect_identifiers(pch_writer* w, ac_macro** macros, size_t count, const ac_token* output, size_t output_count)
+{
+    for (size_t i = 0; i < count; i += 1)
+    {
+        ac_macro* m = macros[i];
+        darrT_push_back(&w->identifiers, m->ident);
+        push_identifiers(w, m->definition, m->definition_count);
+    }
+    push_identifiers(w, output, output_count);
+
+    size_t size = darrT_size(&w->identifiers);
+    if (size == 0)
+    {
+        return;
+    }
+
+    ac_ident** items = darrT_ptr(&w->identifiers, 0);
+    qsort(items, size, sizeof(ac_ident*), compare_pointers);
+
+    /* Remove duplicates. */
+    size_t unique = 1;
+    for (size_t i = 1; i < size; i += 1)
+    {
+        if (items[i] != items[unique - 1])
+        {
+            items[unique] = items[i];
+            unique += 1;
+        }
+    }
+    darrT_resize(&w->identifiers, unique);
+}
+
+static uint64_t identifier_index(pch_writer* w, ac_ident* ident)
+{
+    ac_ident** items = darrT_ptr(&w->identifiers, 0);
+    ac_ident** found = bsearch(&ident, items, darrT_size(&w->identifiers), sizeof(ac_ident*), compare_pointers);
+    AC_ASSERT(found && "Identifier should have been collected.");
+    return (uint64_t)(found - items);
+}
+
+static uint64_t add_string(pch_writer* w, strv text)
+{
+    pch_string s;
+    s.offset = w->blob.size;
+    s.size = text.size;
+
+    dstr_append(&w->blob, text);
+    dstr_append_char(&w->blob, '\0');
+
+    darrT_push_back(&w->strings, s);
+    return darrT_size(&w->strings) - 1;
+}
+
+static void add_macro(pch_writer* w, ac_macro* m)
+{
+    pch_macro pm;
+    memset(&pm, 0, sizeof(pm));
+    pm.name = identifier_index(w, m->ident);
+    pm.first_token = darrT_size(&w->tokens);
+    pm.token_count = m->definition_count;
+    pm.params_start = m->params.start;
+    pm.params_end = m->params.end;
+    pm.body_start = m->body.start;
+    pm.body_end = m->body.end;
+    pm.filepath = add_string(w, m->location.filepath);
+    pm.row = m->location.row;
+    pm.col = m->location.col;
+    pm.pos = m->location.pos;
+    pm.is_function_like = m->is_function_like;
+
+    add_tokens(w, m->definition, m->definition_count);
+
+    darrT_push_back(&w->macros, pm);
+}
+
+static uint64_t add_tokens(pch_writer* w, const ac_token* tokens, size_t count)
+{
+    uint64_t first = darrT_size(&w->tokens);
+    for (size_t i = 0; i < count; i += 1)
+    {
+        ac_token t = tokens[i];
+
+        uint64_t index;
+        if (ac_token_is_keyword_or_identifier(t.type))
+            index = identifier_index(w, t.ident);
+        else if (t.text.data == NULL)
+            index = NO_STRING;
+        else
+            index = add_string(w, t.text);
+
+        t.text.data = NULL;
+        t.text.size = index;
+        darrT_push_back(&w->tokens, t);
+    }
+    return first;
+}
+
+static bool write_section(FILE* file, const void* data, size_t size)
+{
+    static const char padding[8] = { 0 };
+
+    if (size && fwrite(data, 1, size, file) != size)
+    {
+        return false;
+    }
+
+    size_t padding_size = (8 - size % 8) % 8;
+    return padding_size == 0 || fwrite(padding, 1, padding_size, file) == padding_size;
+}
+
+static bool file_status(const char* filepath, uint64_t* size, int64_t* mtime)
+{
+    struct stat st;
+    if (stat(filepath, &st) != 0)
+    {
+        return false;
+    }
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+static bool section_fits(strv content, size_t* offset, uint64_t count, size_t size)
+{
+    if (*offset > content.size
+        || count > (content.size - *offset) / size)
+    {
+        return false;
+    }
+
+    *offset += (size_t)count * size;
+    *offset += (8 - *offset % 8) % 8;
+    return true;
+}
+
+static bool read_token(ac_manager* mgr, const pch_header* h, const pch_string* strings, const char* blob, ac_ident** identifiers, ac_token* t)
+{
+    uint64_t index = t->text.size;
+
+    if (ac_token_is_keyword_or_identifier(t->type))
+    {
+        if (index >= h->identifier_count)
+            return false;
+
+        t->ident = identifiers[index];
+    }
+    else if (index == NO_STRING)
+    {
+        t->text = strv_make();
+    }
+    else
+    {
+        if (index >= h->string_count)
+            return false;
+
+        t->text = ac_create_or_reuse_literal(mgr, strv_make_from(blob + strings[index].offset, strings[index].size));
+    }
+    return true;
+}
+
+static bool report_invalid(const char* filepath)
+{
+    ac_report_error("invalid precompiled header '%s'", filepath);
+    return false;
+}
@@ -0,0 +1,29 @@
+#ifndef AC_PCH_H
+#define AC_PCH_H
+
+#include "preprocessor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Precompiled header.
+    It contains all the macros defined at the end of a preprocessed file, the tokens it produced,
+    and the size and modification time of all the files loaded to produce them.
+    A precompiled header is rejected if one of those files has changed.
+*/
+
+/* Save the current macros of the preprocessor and the tokens it produced. */
+bool ac_pch_save(ac_pp* pp, const char* filepath, const ac_token* output, size_t output_count);
+
+/* Replace the macros of the preprocessor with the ones from the precompiled header,
+   the tokens it contains are returned by the preprocessor before the ones of its file.
+   The file is mapped in memory by the manager and must not change while the manager is alive. */
+bool ac_pch_load(ac_pp* pp, const char* filepath);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_PCH_H */
@@ -0,0 +1,261 @@
+#include "pp_profile.h"
+
+#include <stdlib.h> /* qsort */
+
+#include "re/file.h"
+
+#include "lexer.h"
+
+enum {
+    MAX_PRINTED_ENTRIES = 20, /* Maximum number of macros and files printed in the table. */
+};
+
+/* Index of an entry in one of the arrays of the profile. */
+typedef struct profile_slot profile_slot;
+struct profile_slot {
+    const void* key;
+    size_t index;
+};
+
+static ht_hash_t slot_hash(profile_slot* s);                                 /* For hash table. */
+static ht_bool slots_are_same(profile_slot* left, profile_slot* right);      /* For hash table. */
+static void swap_slots(profile_slot* left, profile_slot* right);             /* For hash table. */
+
+/* Returns the index of the key, 'count' is used as index if the key is new. */
+static size_t index_of(ht* indices, const void* key, size_t count, bool* is_new);
+
+static int compare_macros(const void* left, const void* right); /* Most expensive first. */
+static int compare_files(const void* left, const void* right);  /* Most expensive first. */
+static double ms(uint64_t ns);
+static void print_json_string(FILE* file, strv str);
+
+void ac_pp_profile_init(ac_pp_profile* p)
+{
+    memset(p, 0, sizeof(ac_pp_profile));
+
+    darrT_init(&p->macros);
+    darrT_init(&p->files);
+    darrT_init(&p->frames);
+
+    ht_init(&p->macro_indices,
+        sizeof(profile_slot),
+        (ht_hash_function_t)slot_hash,
+        (ht_predicate_t)slots_are_same,
+        (ht_swap_function_t)swap_slots,
+        0);
+
+    ht_init(&p->file_indices,
+        sizeof(profile_slot),
+        (ht_hash_function_t)slot_hash,
+        (ht_predicate_t)slots_are_same,
+        (ht_swap_function_t)swap_slots,
+        0);
+}
+
+void ac_pp_profile_destroy(ac_pp_profile* p)
+{
+    ht_destroy(&p->file_indices);
+    ht_destroy(&p->macro_indices);
+    darrT_destroy(&p->frames);
+    darrT_destroy(&p->files);
+    darrT_destroy(&p->macros);
+}
+
+void ac_pp_profile_add_expansion(ac_pp_profile* p, ac_ident* ident, size_t token_count, uint64_t ns)
+{
+    bool is_new;
+    size_t i = index_of(&p->macro_indices, ident, darrT_size(&p->macros), &is_new);
+    if (is_new)
+    {
+        ac_pp_macro_profile m = { .ident = ident };
+        darrT_push_back(&p->macros, m);
+    }
+
+    ac_pp_macro_profile* m = darrT_ptr(&p->macros, i);
+    m->expansion_count += 1;
+    m->token_count += token_count;
+    m->ns += ns;
+}
+
+void ac_pp_profile_enter_file(ac_pp_profile* p, strv filepath, size_t size)
+{
+    /* File paths are unique per file, the manager returns the same path each time a file is loaded. */
+    bool is_new;
+    size_t i = index_of(&p->file_indices, filepath.data, darrT_size(&p->files), &is_new);
+    if (is_new)
+    {
+        ac_pp_file_profile f = { .filepath = filepath };
+        darrT_push_back(&p->files, f);
+    }
+
+    darrT_ptr(&p->files, i)->include_count += 1;
+
+    ac_pp_profile_frame frame = { .file_index = i, .size = size, .start_ns = ac_time_ns() };
+    darrT_push_back(&p->frames, frame);
+}
+
+void ac_pp_profile_leave_file(ac_pp_profile* p)
+{
+    AC_ASSERT(darrT_size(&p->frames));
+
+    ac_pp_profile_frame frame = darrT_last(&p->frames);
+    darrT_pop_back(&p->frames);
+
+    uint64_t elapsed = ac_time_ns() - frame.start_ns;
+
+    ac_pp_file_profile* f = darrT_ptr(&p->files, frame.file_index);
+    f->inclusive_ns += elapsed;
+    f->self_ns += elapsed - frame.children_ns;
+    f->skipped_bytes += frame.skipped_bytes;
+    f->lexed_bytes += frame.size - frame.skipped_bytes;
+
+    if (darrT_size(&p->frames))
+    {
+        darrT_last(&p->frames).children_ns += elapsed;
+    }
+}
+
+void ac_pp_profile_skip(ac_pp_profile* p, size_t byte_count)
+{
+    if (darrT_size(&p->frames))
+    {
+        darrT_last(&p->frames).skipped_bytes += byte_count;
+    }
+}
+
+void ac_pp_profile_sort(ac_pp_profile* p)
+{
+    size_t macro_count = darrT_size(&p->macros);
+    size_t file_count = darrT_size(&p->files);
+
+    if (macro_count)
+        qsort(darrT_ptr(&p->macros, 0), macro_count, sizeof(ac_pp_macro_profile), compare_macros);
+    if (file_count)
+        qsort(darrT_ptr(&p->files, 0), file_count, sizeof(ac_pp_file_profile), compare_files);
+
+    /* Indices are outdated after sorting. */
+    ht_clear(&p->macro_indices);
+    ht_clear(&p->file_indices);
+}
+
+void ac_pp_profile_print(ac_pp_profile* p, FILE* file)
+{
+    size_t macro_count = darrT_size(&p->macros);
+    size_t file_count = darrT_size(&p->files);
+
+    fprintf(file, "%-32s %12s %12s %12s\n", "macro", "expansions", "tokens", "time (ms)");
+    for (size_t i = 0; i < macro_count && i < MAX_PRINTED_ENTRIES; i += 1)
+    {
+        ac_pp_macro_profile* m = darrT_ptr(&p->macros, i);
+        fprintf(file, "%-32.*s %12zu %12zu %12.3f\n",
+            STRV_ARG(m->ident->text), m->expansion_count, m->token_count, ms(m->ns));
+    }
+
+    fprintf(file, "\n%-32s %8s %12s %12s %12s %14s\n", "file", "includes", "lexed", "skipped", "self (ms)", "inclusive (ms)");
+    for (size_t i = 0; i < file_count && i < MAX_PRINTED_ENTRIES; i += 1)
+    {
+        ac_pp_file_profile* f = darrT_ptr(&p->files, i);
+        fprintf(file, "%-32.*s %8zu %12zu %12zu %12.3f %14.3f\n",
+            STRV_ARG(f->filepath), f->include_count, f->lexed_bytes, f->skipped_bytes, ms(f->self_ns), ms(f->inclusive_ns));
+    }
+}
+
+bool ac_pp_profile_write_json(ac_pp_profile* p, const char* filepath)
+{
+    FILE* file = re_file_open(filepath, "wb");
+    if (!file)
+    {
+        ac_report_error("could not open '%s' for writing", filepath);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"macros\": [");
+    for (size_t i = 0; i < darrT_size(&p->macros); i += 1)
+    {
+        ac_pp_macro_profile* m = darrT_ptr(&p->macros, i);
+        fprintf(file, i ? ",\n    {\"name\": " : "\n    {\"name\": ");
+        print_json_string(file, m->ident->text);
+        fprintf(file, ", \"expansions\": %zu, \"tokens\": %zu, \"ms\": %.3f}",
+            m->expansion_count, m->token_count, ms(m->ns));
+    }
+
+    fprintf(file, "\n  ],\n  \"files\": [");
+    for (size_t i = 0; i < darrT_size(&p->files); i += 1)
+    {
+        ac_pp_file_profile* f = darrT_ptr(&p->files, i);
+        fprintf(file, i ? ",\n    {\"path\": " : "\n    {\"path\": ");
+        print_json_string(file, f->filepath);
+        fprintf(file, ", \"includes\": %zu, \"lexed_bytes\": %zu, \"skipped_bytes\": %zu, \"self_ms\": %.3f, \"inclusive_ms\": %.3f}",
+            f->include_count, f->lexed_bytes, f->skipped_bytes, ms(f->self_ns), ms(f->inclusive_ns));
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    re_file_close(file);
+    return true;
+}
+
+static ht_hash_t slot_hash(profile_slot* s)
+{
+    return ac_hash((char*)&s->key, sizeof(s->key));
+}
+
+static ht_bool slots_are_same(profile_slot* left, profile_slot* right)
+{
+    return left->key == right->key;
+}
+
+static void swap_slots(profile_slot* left, profile_slot* right)
+{
+    profile_slot tmp = *left;
+    *left = *right;
+    *right = tmp;
+}
+
+static size_t index_of(ht* indices, const void* key, size_t count, bool* is_new)
+{
+    profile_slot s = { .key = key, .index = count };
+
+    profile_slot* existing = ht_get_item(indices, &s);
+    *is_new = existing == NULL;
+    if (existing)
+    {
+        return existing->index;
+    }
+
+    ht_insert(indices, &s);
+    return count;
+}
+
+static int compare_macros(const void* left, const void* right)
+{
+    const ac_pp_macro_profile* l = left;
+    const ac_pp_macro_profile* r = right;
+    return (l->ns < r->ns) - (l->ns > r->ns);
+}
+
+static int compare_files(const void* left, const void* right)
+{
+    const ac_pp_file_profile* l = left;
+    const ac_pp_file_profile* r = right;
+    return (l->inclusive_ns < r->inclusive_ns) - (l->inclusive_ns > r->inclusive_ns);
+}
+
+static double ms(uint64_t ns)
+{
+    return (double)ns / 1e6;
+}
+
+static void print_json_string(FILE* file, strv str)
+{
+    fputc('"', file);
+    for (size_t i = 0; i < str.size; i += 1)
+    {
+        char c = str.data[i];
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(c, file);
+    }
+    fputc('"', file);
+}
@@ -0,0 +1,77 @@
+#ifndef AC_PP_PROFILE_H
+#define AC_PP_PROFILE_H
+
+#include "global.h"
+#include "re_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_ident ac_ident;
+
+/* Cost of a macro over the whole preprocessing. */
+typedef struct ac_pp_macro_profile ac_pp_macro_profile;
+struct ac_pp_macro_profile {
+    ac_ident* ident;
+    size_t expansion_count;
+    size_t token_count;  /* Tokens produced by all the expansions. */
+    /* Time spent expanding the macro, argument expansions included, rescan of the result excluded.
+       A macro used in an argument is counted in its own profile and in the one of the outer macro. */
+    uint64_t ns;
+};
+
+/* Cost of a file over all its inclusions. */
+typedef struct ac_pp_file_profile ac_pp_file_profile;
+struct ac_pp_file_profile {
+    strv filepath;
+    size_t include_count;
+    size_t lexed_bytes;   /* Bytes of the file processed by the lexer. */
+    size_t skipped_bytes; /* Bytes of the file jumped over with the skipped #if blocks. */
+    uint64_t self_ns;      /* Time spent in the file, the included files excluded. */
+    uint64_t inclusive_ns; /* Time spent in the file, the included files included. */
+};
+
+/* File being preprocessed. */
+typedef struct ac_pp_profile_frame ac_pp_profile_frame;
+struct ac_pp_profile_frame {
+    size_t file_index;
+    size_t size;
+    size_t skipped_bytes;
+    uint64_t start_ns;
+    uint64_t children_ns;
+};
+
+typedef struct ac_pp_profile ac_pp_profile;
+struct ac_pp_profile {
+    darrT(ac_pp_macro_profile) macros;
+    darrT(ac_pp_file_profile) files;
+    ht macro_indices; /* Index of the macro profile from the identifier. */
+    ht file_indices;  /* Index of the file profile from the file path. */
+
+    darrT(ac_pp_profile_frame) frames; /* Stack of included files. */
+};
+
+void ac_pp_profile_init(ac_pp_profile* p);
+void ac_pp_profile_destroy(ac_pp_profile* p);
+
+void ac_pp_profile_add_expansion(ac_pp_profile* p, ac_ident* ident, size_t token_count, uint64_t ns);
+
+/* Must be called when the file starts and ends being preprocessed. */
+void ac_pp_profile_enter_file(ac_pp_profile* p, strv filepath, size_t size);
+void ac_pp_profile_leave_file(ac_pp_profile* p);
+/* Bytes of the current file which have not been lexed. */
+void ac_pp_profile_skip(ac_pp_profile* p, size_t byte_count);
+
+/* Sort macros and files, the most expensive first. The profile cannot be updated afterward. */
+void ac_pp_profile_sort(ac_pp_profile* p);
+/* Print the first macros and files as a table. */
+void ac_pp_profile_print(ac_pp_profile* p, FILE* file);
+/* Write all the entries as JSON. */
+bool ac_pp_profile_write_json(ac_pp_profile* p, const char* filepath);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_PP_PROFILE_H */
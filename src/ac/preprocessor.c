@@ -2,6 +2,10 @@
 
 #include <time.h>
 
+#include "pch.h"
+#include "stats.h"
+#include "trace.h"
+
 /* @FIXME: predefines are always static for now. */
 #define AC_STATIC_PREDEFINES
 
@@ -9,43 +13,15 @@
 #include "predefines.g.h"
 #endif
 
-typedef struct range range;
-struct range {
-    size_t start;
-    size_t end;
-};
-
-typedef darrT(range) darr_range;
-
-size_t range_size(range r) { return r.end - r.start; }
-
-typedef struct ac_macro ac_macro;
-struct ac_macro {
-    ac_ident* ident;        /* Name of the macro */
-    /* Example of function-like macro:
-         #define X(x, y) (x + y)
-       Example of object-like macro:
-         #define Y (1 + 2) */
-    bool is_function_like;
-
-    darr_token definition; /* Contains tokens from parameters and body. */
-    range params;          /* If function-like macro, range of tokens from definition representing the parameters. Parsed at directive-time. */
-    range body;            /* Range of token from definition representing the body. Parsed at directive-time.*/
+/* Arguments of a macro expansion and their ranges, they are in the scratch memory of the expansion. */
+typedef ac_scratch_arrayT(ac_token) scratch_tokens;
+typedef ac_scratch_arrayT(range) scratch_ranges;
 
-    ac_location location;
+enum {
+    TRACED_EXPANSION_MIN_TOKEN_COUNT = 256, /* Smaller macro expansions are not traced. */
 };
 
-static void ac_macro_init(ac_macro* m)
-{
-    memset(m, 0, sizeof(ac_macro));
-
-    darrT_init(&m->definition);
-}
-
-static void ac_macro_destroy(ac_macro* m)
-{
-    darrT_destroy(&m->definition);
-}
+size_t range_size(range r) { return r.end - r.start; }
 
 /* Get token from the stack or from the lexer. */
 static ac_token* goto_next_raw_token(ac_pp* pp);
@@ -68,6 +44,8 @@ static bool parse_directive(ac_pp* pp);
 static bool parse_macro_definition(ac_pp* pp);
 static bool parse_macro_parameters(ac_pp* pp, ac_macro* m);
 static bool parse_macro_body(ac_pp* pp, ac_macro* m);
+/* Copy the definition buffer to the preprocessor arena, it's the definition of the macro. */
+static void store_macro_definition(ac_pp* pp, ac_macro* m);
 static bool parse_include_directive(ac_pp* pp);
 static bool parse_include_path(ac_pp* pp, strv* path, bool* is_system_path);
 /* Look if a specific file exists in any directories from the array.
@@ -89,22 +67,28 @@ static bool try_expand(ac_pp* pp, ac_token* token);
 static size_t find_parameter_index(ac_token* token, ac_macro* m);
 
 /* Concatenate two tokens and add them to the expanded_token array of the macro. */
-static void concat(ac_pp* pp, darr_token* arr, ac_macro* m, ac_token left, ac_token right);
+static void concat(ac_pp* pp, sdarr_token* arr, ac_macro* m, ac_token left, ac_token right);
 /* Stringize the token (used by operator '#') */
 static ac_token stringize(ac_pp* pp, ac_token* tokens, size_t count);
 
 /* Add token to the expanded_token array of the macro.
    This also handle the concat operator '##'. */
-static void push_back_expanded_token(ac_pp* pp, darr_token* arr, ac_macro* m, ac_token token);
+static void push_back_expanded_token(ac_pp* pp, sdarr_token* arr, ac_macro* m, ac_token token);
 
 /* Add empty argument to sequence of tokens. */
-static void add_empty_arg(darr_token* args, darr_range* ranges);
+static void add_empty_arg(scratch_tokens* args, scratch_ranges* ranges);
 
 /* Return true if something has been expanded.
    The expanded tokens are pushed into a stack used to pick the next token. */
 static bool expand_macro(ac_pp* pp, ac_token* ident, ac_macro* m);
 
 static ac_macro* create_macro(ac_pp* pp, ac_ident* ident, ac_location location);
+/* Current macro of the identifier, NULL if it's not defined. */
+static ac_macro* macro_of(ac_pp* pp, ac_ident* ident);
+/* Define or undefine (if 'm' is NULL) a macro. */
+static void set_macro(ac_pp* pp, ac_ident* ident, ac_macro* m);
+/* Invalidate the macro cache of all identifiers. */
+static void new_macro_generation(ac_pp* pp);
 
 static ac_location location(ac_pp* pp); /* Return location of the current token. */
 
@@ -113,8 +97,8 @@ static ac_token* token_ptr(ac_pp* pp);   /* Current token by pointer. */
 static bool expect(ac_pp* pp, enum ac_token_type type);
 
 static ac_token_cmd make_cmd_token_list(ac_token* ptr, size_t count);
-static ac_token_cmd make_cmd_macro_pop(ac_macro* m, darr_token tokens);
-static ac_token_cmd to_cmd_token_list(darr_token* arr);
+static ac_token_cmd make_cmd_macro_pop(ac_macro* m, re_arena_mark mark);
+static ac_token_cmd to_cmd_token_list(sdarr_token* arr);
 
 /*-----------------------------------------------------------------------*/
 /* Preprocessor evaluation */
@@ -128,7 +112,7 @@ struct eval_t {
     bool succes;
 };
 
-static eval_t eval_false = { 0, false};
+static const eval_t eval_false = { 0, false};
 
 static ac_token* goto_next_for_eval(ac_pp* pp);
 
@@ -148,11 +132,29 @@ static bool branch_is(ac_pp* pp, enum ac_token_type type);
 static bool branch_is_empty(ac_pp* pp);
 static bool branch_was_enabled(ac_pp* pp);
 
+/*-----------------------------------------------------------------------*/
+/* Memoization of conditional directives */
+/*-----------------------------------------------------------------------*/
+
+/* Memos are keyed by the address of the directive in the file content. */
+#define eval_memo_hash(m) ac_hash((char*)&(m)->key, sizeof((m)->key))
+#define eval_memos_are_same(left, right) ((left)->key == (right)->key)
+HTT_DEFINE(ac_eval_memo_table, ac_eval_memo, eval_memo_hash, eval_memos_are_same)
+
+/* Returns the key of the current conditional directive, or NULL if the directive cannot be memoized. */
+static const char* eval_memo_key(ac_pp* pp);
+/* Returns the memoized result if all its dependencies are still the same, NULL otherwise. */
+static ac_eval_memo* find_valid_eval_memo(ac_pp* pp, const char* key);
+static void begin_eval_recording(ac_pp* pp);
+/* Stop the recording and memoize the result if possible. */
+static void end_eval_recording(ac_pp* pp, const char* key, eval_t eval);
+static void record_eval_dependency(ac_pp* pp, ac_token* tok);
+
 /*-----------------------------------------------------------------------*/
 /* #include related code */
 /*-----------------------------------------------------------------------*/
 
-static void push_include_stack(ac_pp* pp, strv content, strv filepath);
+static void push_include_stack(ac_pp* pp, ac_source_file* src_file);
 static void pop_include_stack(ac_pp* pp);
 
 static void consume_predefines(ac_pp* pp);
@@ -171,26 +173,69 @@ void ac_pp_init(ac_pp* pp, ac_manager* mgr, strv content, strv filepath)
     ac_lex_init(&pp->concat_lex, mgr);
 
     darrT_init(&pp->cmd_stack);
-    darrT_init(&pp->macros);
-    darrT_init(&pp->buffer_for_peek);
+    ac_macro_map_init(&pp->macro_map);
+    new_macro_generation(pp);
+    sdarr_token_init(&pp->buffer_for_peek);
+    ac_allocator_arena_init_kind(&pp->expansions_arena, ac_arena_kind_VIRTUAL, (size_t)256 << 20);
     dstr_init(&pp->concat_buffer);
+    darrT_init(&pp->definition_buffer);
+
+    ac_eval_memo_table_init(&pp->eval_memos);
+    darrT_init(&pp->eval_dependencies);
 
     /* Predefine system-specific macro. */
     if ( ! mgr->options->no_system_specific)
     {
-        consume_predefines(pp);
+        /* Predefines are processed only once per manager. */
+        if (mgr->has_predefined_macros)
+        {
+            pp->macro_map = mgr->predefined_macros;
+        }
+        else
+        {
+            consume_predefines(pp);
+
+            /* Reset concat buffer after predefines. */
+            dstr_clear(&pp->concat_buffer);
+
+            mgr->predefined_macros = pp->macro_map;
+            mgr->has_predefined_macros = true;
+        }
+    }
+
+    /* Macros of the precompiled header replace the predefined ones. */
+    bool pch_loaded = !mgr->options->include_pch
+        || ac_pch_load(pp, mgr->options->include_pch);
 
-        /* Reset concat buffer after predefines. */
-        dstr_clear(&pp->concat_buffer);
+    /* Only count what comes from the actual source file. */
+    memset(&pp->stats, 0, sizeof(pp->stats));
+    pp->stats.byte_count = content.size;
+
+    if (mgr->options->profile_preprocessor)
+    {
+        pp->profile = ac_arena_new_zero(&mgr->preprocessor_arena, ac_pp_profile);
+        ac_pp_profile_init(pp->profile);
+        ac_pp_profile_enter_file(pp->profile, filepath, content.size);
     }
 
     ac_lex_set_content(&pp->lex, content, filepath);
+
+    pp->directives_only = mgr->options->scan_deps;
+
+    /* The first token returned is an error. */
+    if (!pch_loaded)
+    {
+        pp->eof = ac_token_eof();
+        pp->eof.is_premature_eof = true;
+        push_cmd(pp, make_cmd_token_list(&pp->eof, 1));
+    }
 }
 
 void ac_pp_destroy(ac_pp* pp)
 {
     dstr_destroy(&pp->concat_buffer);
-    darrT_destroy(&pp->buffer_for_peek);
+    darrT_destroy(&pp->definition_buffer);
+    sdarr_token_destroy(&pp->buffer_for_peek);
     
     ac_lex_destroy(&pp->concat_lex);
     ac_lex_destroy(&pp->lex);
@@ -202,15 +247,59 @@ void ac_pp_destroy(ac_pp* pp)
     }
 
     darrT_destroy(&pp->cmd_stack);
+    ac_allocator_arena_destroy(&pp->expansions_arena);
+
+    ac_eval_memo_table_destroy(&pp->eval_memos);
+    darrT_destroy(&pp->eval_dependencies);
+
+    if (pp->profile)
+    {
+        ac_pp_profile_destroy(pp->profile);
+    }
+}
+
+ac_pp_checkpoint ac_pp_save_checkpoint(ac_pp* pp)
+{
+    ac_pp_checkpoint c;
+    c.macros = pp->macro_map;
+    c.counter_value = pp->counter_value;
+    return c;
+}
+
+void ac_pp_restore_checkpoint(ac_pp* pp, const ac_pp_checkpoint* c)
+{
+    AC_ASSERT(pp->macro_depth == 0 && "Cannot restore checkpoint while expanding a macro.");
+
+    pp->macro_map = c->macros;
+    pp->counter_value = c->counter_value;
+
+    new_macro_generation(pp);
+}
+
+void ac_pp_push_tokens(ac_pp* pp, ac_token* tokens, size_t count)
+{
+    if (count)
+    {
+        push_cmd(pp, make_cmd_token_list(tokens, count));
+    }
+}
+
+bool ac_pp_report_profile(ac_pp* pp)
+{
+    if (!pp->profile)
+    {
+        return true;
+    }
 
-    /* Destroy all macros. */
-    for (int i = 0; i < darrT_size(&pp->macros); i += 1)
+    /* Files are still opened if the preprocessing did not reach the end. */
+    while (darrT_size(&pp->profile->frames))
     {
-        ac_macro* m = darrT_at(&pp->macros, i);
-        ac_macro_destroy(m);
+        ac_pp_profile_leave_file(pp->profile);
     }
 
-    darrT_destroy(&pp->macros);
+    ac_pp_profile_sort(pp->profile);
+    ac_pp_profile_print(pp->profile, stderr);
+    return ac_pp_profile_write_json(pp->profile, pp->mgr->options->profile_preprocessor);
 }
 
 ac_token* ac_pp_goto_next(ac_pp* pp)
@@ -239,10 +328,17 @@ ac_token* ac_pp_goto_next(ac_pp* pp)
         }
         else
         {
+            /* End of the main file. */
+            if (pp->profile && darrT_size(&pp->profile->frames))
+            {
+                ac_pp_profile_leave_file(pp->profile);
+            }
             break;
         }
     }
 
+    pp->stats.token_count += t->type != ac_token_type_EOF;
+
     return t;
 }
 
@@ -263,7 +359,7 @@ void ac_pp_preprocess(ac_pp* pp, FILE* file)
             continue;
         }
 
-        ac_token_fprint(stdout, *token);
+        ac_token_fprint(file, *token);
 
         previous_token = *token;
     }
@@ -273,13 +369,34 @@ void ac_pp_preprocess_benchmark(ac_pp* pp, FILE* file)
 {
     const ac_token* token = NULL;
 
+    uint64_t start = ac_time_ns();
+
     while ((token = ac_pp_goto_next(pp)) != NULL
         && token->type != ac_token_type_EOF)
     {
     }
 
-    /* @TODO display line count, byte count, and number of identifiers.
-       @TODO display time, line per seconds and bytes per seconds. */
+    double seconds = (double)(ac_time_ns() - start) / 1e9;
+
+    /* Lines of the main file, the included ones are counted when they are popped. */
+    pp->stats.line_count += pp->lex.location.row;
+
+    if (seconds <= 0.0)
+    {
+        seconds = 1e-9;
+    }
+
+    fprintf(file, "lines:       %zu\n", pp->stats.line_count);
+    fprintf(file, "bytes:       %zu\n", pp->stats.byte_count);
+    fprintf(file, "tokens:      %zu\n", pp->stats.token_count);
+    fprintf(file, "identifiers: %zu\n", (size_t)ac_ident_table_size(&pp->mgr->identifiers));
+    fprintf(file, "literals:    %zu\n", (size_t)ac_string_table_size(&pp->mgr->literals));
+    fprintf(file, "expansions:  %zu\n", pp->stats.expansion_count);
+    fprintf(file, "includes:    %zu\n", pp->stats.include_count);
+    fprintf(file, "memoized:    %zu\n", pp->stats.memoized_eval_count);
+    fprintf(file, "time:        %.3f ms\n", seconds * 1e3);
+    fprintf(file, "lines/s:     %.0f\n", (double)pp->stats.line_count / seconds);
+    fprintf(file, "bytes/s:     %.0f\n", (double)pp->stats.byte_count / seconds);
 }
 
 static ac_token* goto_next_raw_token(ac_pp* pp)
@@ -288,9 +405,26 @@ static ac_token* goto_next_raw_token(ac_pp* pp)
     /* Get token from previously expanded macros if there are any left. */
     ac_token* token_node = stack_pop(pp);
 
-    pp->current_token = token_node
-        ? token_node
-        : ac_lex_goto_next(&pp->lex);
+    if (token_node)
+    {
+        pp->current_token = token_node;
+    }
+    /* A new line is starting, go straight to the next directive. */
+    else if (pp->directives_only && pp->lex.beginning_of_line)
+    {
+        const char* text_start = pp->lex.cur;
+
+        pp->current_token = ac_lex_goto_next_directive(&pp->lex);
+
+        if (pp->profile)
+        {
+            ac_pp_profile_skip(pp->profile, pp->lex.cur - text_start);
+        }
+    }
+    else
+    {
+        pp->current_token = ac_lex_goto_next(&pp->lex);
+    }
 
     return pp->current_token;
 }
@@ -308,7 +442,8 @@ static ac_token* goto_next_normal_token(ac_pp* pp)
         if (!parse_directive(pp)
             || token_ptr(pp)->type == ac_token_type_EOF)
         {
-            return ac_token_eof(pp);
+            pp->eof = ac_token_eof();
+            return &pp->eof;
         }
     }
 
@@ -472,14 +607,30 @@ branch_case:
                 /* If one of the previous branch was enabled we need to skip this one. */
                 need_to_skip_block = branch_was_enabled(pp);
             } else {
-                if (t == ac_token_type_IF
+                /* The expression is not needed if the previous result of the same directive is still valid. */
+                const char* memo_key = eval_memo_key(pp);
+                ac_eval_memo* memo = memo_key ? find_valid_eval_memo(pp, memo_key) : NULL;
+
+                if (memo)
+                {
+                    skip_all_until_new_line(pp);
+                }
+                else if (t == ac_token_type_IF
                     || t == ac_token_type_ELIF
                     || t == ac_token_type_ELSE)
                 {
+                    if (memo_key)
+                    {
+                        begin_eval_recording(pp);
+                    }
                     goto_next_for_eval(pp); /* Skip if/elif/else and get the next expanded token. */
                 }
                 else 
                 {
+                    if (memo_key)
+                    {
+                        begin_eval_recording(pp);
+                    }
                     goto_next_token_from_directive(pp); /* Skip ifdef/ifndef/elifdef/elifndef and get next non-expanded_token. */
                 }
 
@@ -493,6 +644,7 @@ branch_case:
                 /* If one of the previous branch was enabled we need to skip the current one. */
                 if (branch_was_enabled(pp))
                 {
+                    pp->eval_is_recording = false;
                     need_to_skip_block = true;
                 }
                 /* Otherwise we evaluate the expression and check if we need to skip the block or not.*/
@@ -502,7 +654,21 @@ branch_case:
                         || t == ac_token_type_IFNDEF
                         || t == ac_token_type_ELIFDEF
                         || t == ac_token_type_ELIFNDEF;
-                    eval_t eval = eval_expr(pp, require_identifier_expression);
+                    eval_t eval = { 0, true };
+                    if (memo)
+                    {
+                        eval.value = memo->value;
+                        pp->stats.memoized_eval_count += 1;
+                    }
+                    else
+                    {
+                        eval = eval_expr(pp, require_identifier_expression);
+                        if (memo_key)
+                        {
+                            end_eval_recording(pp, memo_key, eval);
+                        }
+                    }
+
                     if (!eval.succes)
                     {
                         return false;
@@ -524,8 +690,17 @@ branch_case:
             {
                 bool was_end_of_line = token(pp).type == ac_token_type_NEW_LINE;
 
+                const char* block_start = pp->lex.cur;
+
                 pp->current_token = ac_skip_preprocessor_block(&pp->lex, was_end_of_line);
 
+                AC_STATS_ADD(skipped_byte_count, pp->lex.cur - block_start);
+
+                if (pp->profile)
+                {
+                    ac_pp_profile_skip(pp->profile, pp->lex.cur - block_start);
+                }
+
                 if (pp->current_token->type == ac_token_type_EOF)
                 {
                     /* NOTE: "unterminated <branch> error will be displayed later */
@@ -579,9 +754,9 @@ branch_case:
         skip_all_until_new_line(pp);
 
         /* Set macro to null if it was previously defined. */
-        if (identifier.ident->macro)
+        if (macro_of(pp, identifier.ident))
         {
-            identifier.ident->macro = NULL;
+            set_macro(pp, identifier.ident, NULL);
         }
         break;
     }
@@ -700,6 +875,7 @@ static bool parse_macro_definition(ac_pp* pp)
     ac_token* identifier = token_ptr(pp);
     ac_location loc = location(pp);
     ac_macro* m = create_macro(pp, identifier->ident, loc);
+    darrT_clear(&pp->definition_buffer);
 
     goto_next_raw_token(pp); /* Skip identifier, but not the whitespaces or comment. */
 
@@ -728,10 +904,10 @@ static bool parse_macro_definition(ac_pp* pp)
         return false;
     }
 
-    m->ident->macro = m;
+    set_macro(pp, m->ident, m);
 
-    /* Keep reference of macro to destroy it when preprocessor is destroy. */
-    darrT_push_back(&pp->macros, m);
+    /* Keep reference of macro to destroy it when the manager is destroyed. */
+    darrT_push_back(&pp->mgr->macros, m);
 
     return true;
 }
@@ -747,7 +923,7 @@ static bool parse_macro_parameters(ac_pp* pp, ac_macro* m)
 
     if (token(pp).type == ac_token_type_IDENTIFIER) /* Only allow identifiers in macro parameters. */
     {
-        darrT_push_back(&m->definition, token(pp));
+        darrT_push_back(&pp->definition_buffer, token(pp));
 
         goto_next_token_from_directive(pp); /* Skip identifier. */
 
@@ -759,7 +935,7 @@ static bool parse_macro_parameters(ac_pp* pp, ac_macro* m)
             {
                 break;
             }
-            darrT_push_back(&m->definition, token(pp));
+            darrT_push_back(&pp->definition_buffer, token(pp));
 
             goto_next_token_from_directive(pp); /* Skip identifier. */
         }
@@ -772,26 +948,28 @@ static bool parse_macro_parameters(ac_pp* pp, ac_macro* m)
 
     goto_next_token_from_directive(pp); /* Skip ')' */
 
-    range r = { 0u, darrT_size(&m->definition) };
+    range r = { 0u, darrT_size(&pp->definition_buffer) };
     m->params = r;
     return true;
 }
 
 static bool parse_macro_body(ac_pp* pp, ac_macro* m)
 {
-    size_t body_start_index = darrT_size(&m->definition);
+    size_t body_start_index = darrT_size(&pp->definition_buffer);
 
     ac_token* tok = token_ptr(pp);
 
     /* Return early if it's the EOF. */
     if (tok->type == ac_token_type_EOF)
     {
+        store_macro_definition(pp, m);
         return true;
     }
 
     /* Return early if it's a new line */
     if (tok->type == ac_token_type_NEW_LINE)
     {
+        store_macro_definition(pp, m);
         return true;
     }
 
@@ -806,7 +984,7 @@ static bool parse_macro_body(ac_pp* pp, ac_macro* m)
     /* Get every token until the end of the body. */
     do
     {
-        darrT_push_back(&m->definition, *tok);
+        darrT_push_back(&pp->definition_buffer, *tok);
 
         tok = goto_next_token_from_directive(pp);
     } while (tok->type != ac_token_type_NEW_LINE
@@ -818,12 +996,24 @@ static bool parse_macro_body(ac_pp* pp, ac_macro* m)
         return false;
     }
 
-    range r = { body_start_index, darrT_size(&m->definition) };
+    range r = { body_start_index, darrT_size(&pp->definition_buffer) };
     m->body = r;
 
+    store_macro_definition(pp, m);
     return true;
 }
 
+static void store_macro_definition(ac_pp* pp, ac_macro* m)
+{
+    size_t count = darrT_size(&pp->definition_buffer);
+    if (count)
+    {
+        m->definition = (ac_token*)ac_arena_push(&pp->mgr->preprocessor_arena, count * sizeof(ac_token), AC_ALIGNOF(ac_token));
+        memcpy(m->definition, pp->definition_buffer.arr.data, count * sizeof(ac_token));
+    }
+    m->definition_count = count;
+}
+
 static bool parse_include_directive(ac_pp* pp)
 {
     ac_location loc = location(pp);
@@ -842,7 +1032,6 @@ static bool parse_include_directive(ac_pp* pp)
         return false;
     }
 
-    char* dst = pp->path_buffer;
     bool file_found = false;
     /* Search the file to include and build path into the relevant buffer. */
     {
@@ -850,23 +1039,38 @@ static bool parse_include_directive(ac_pp* pp)
             ? (strv)STRV("")
             : re_path_remove_last_segment(pp->lex.filepath);
 
-        if (!combine_filepath(pp, dir, path))
+        /* The same header is often included from the same directory, the file system is only searched once. */
+        strv found;
+        if (ac_manager_get_include(pp->mgr, dir, path, &found))
         {
-            return false;
+            file_found = found.size != 0;
+            if (file_found)
+            {
+                memcpy(pp->path_buffer, found.data, found.size + 1); /* +1 for the null-terminating char. */
+            }
         }
+        else
+        {
+            if (!combine_filepath(pp, dir, path))
+            {
+                return false;
+            }
 
-        file_found = re_file_exists_str(pp->path_buffer);
+            file_found = re_file_exists_str(pp->path_buffer);
 
-        /* Try to look into the user include directory. */
-        if (!file_found)
-        {
-            file_found = look_for_filepath(pp, &pp->mgr->options->user_includes, path);
-        }
+            /* Try to look into the user include directory. */
+            if (!file_found)
+            {
+                file_found = look_for_filepath(pp, &pp->mgr->options->user_includes, path);
+            }
 
-        /* Try to look into the system include directory. */
-        if (!file_found)
-        {
-            file_found = look_for_filepath(pp, &pp->mgr->options->system_includes, path);
+            /* Try to look into the system include directory. */
+            if (!file_found)
+            {
+                file_found = look_for_filepath(pp, &pp->mgr->options->system_includes, path);
+            }
+
+            ac_manager_set_include(pp->mgr, dir, path, file_found ? strv_make_from_str(pp->path_buffer) : strv_make());
         }
 
         if (!file_found)
@@ -886,7 +1090,7 @@ static bool parse_include_directive(ac_pp* pp)
 
     if (src_file.content.size)
     {
-        push_include_stack(pp, src_file.content, src_file.filepath);
+        push_include_stack(pp, &src_file);
     }
 
     return true;
@@ -950,11 +1154,16 @@ static bool parse_include_path(ac_pp* pp, strv* path, bool* is_system_path)
         /* Get next token expended above.*/
         ac_token* t = goto_next_macro_expanded_no_space(pp); /* Skip '<' */
 
-        /* Concatenate all tokens between the '<' '>' into a string. */
-        dstr_clear(&pp->concat_buffer);
+        /* Concatenate all tokens between the '<' '>' into a string, only the interned path outlives the directive. */
+        ac_scratch scope = ac_scratch_begin();
+        ac_scratch_arrayT(char) text;
+        ac_scratch_array_init(&text);
         do {
-
-            dstr_append_f(&pp->concat_buffer, STRV_FMT, STRV_ARG(ac_token_to_strv(*t)));
+            strv sv = ac_token_to_strv(*t);
+            for (size_t i = 0; i < sv.size; i += 1)
+            {
+                ac_scratch_array_push_back(&text, sv.data[i]);
+            }
             t = goto_next_macro_expanded_no_space(pp);
         } while (t->type != ac_token_type_GREATER
             && t->type != ac_token_type_EOF
@@ -962,13 +1171,15 @@ static bool parse_include_path(ac_pp* pp, strv* path, bool* is_system_path)
 
         if (t->type != ac_token_type_GREATER)
         {
+            ac_scratch_end(scope);
             ac_report_error_loc(location(pp), "expect a closing '>'");
             return false;
         }
 
         goto_next_token_from_directive(pp); /* Skip '>', no need to expand macro anymore. */
 
-        *path = ac_create_or_reuse_literal(pp->mgr, dstr_to_strv(&pp->concat_buffer));
+        *path = ac_create_or_reuse_literal(pp->mgr, strv_make_from(text.data, text.size));
+        ac_scratch_end(scope);
         break;
     }
     default:
@@ -1076,7 +1287,7 @@ static ac_token* process_cmd(ac_pp* pp, ac_token_cmd* cmd)
 
         m->ident->cannot_expand = false;
 
-        darrT_destroy(&cmd->macro_pop.tokens);
+        re_arena_rewind(&pp->expansions_arena.arena, cmd->macro_pop.mark);
 
         darrT_pop_back(&pp->cmd_stack);
         break;
@@ -1108,6 +1319,7 @@ static ac_token* stack_pop(ac_pp* pp)
 static void push_cmd(ac_pp* pp, ac_token_cmd cmd)
 {
     darrT_push_back(&pp->cmd_stack, cmd);
+    AC_STATS_MAX(cmd_stack_max_depth, darrT_size(&pp->cmd_stack));
 }
 
 static void handle_some_special_macros(ac_pp* pp, ac_token* tok)
@@ -1178,7 +1390,12 @@ static bool try_expand(ac_pp* pp, ac_token* tok)
         return false;
     }
 
-    ac_macro* m = tok->ident->macro;
+    if (pp->eval_is_recording)
+    {
+        record_eval_dependency(pp, tok);
+    }
+
+    ac_macro* m = macro_of(pp, tok->ident);
 
     if (!m)
     {
@@ -1203,12 +1420,12 @@ static bool try_expand(ac_pp* pp, ac_token* tok)
     {
         goto_next_token_from_macro_agrument(pp); /* Skip identifier. */
 
-        darrT_clear(&pp->buffer_for_peek);
+        sdarr_token_clear(&pp->buffer_for_peek);
 
         while (token(pp).type == ac_token_type_HORIZONTAL_WHITESPACE
             || token(pp).type == ac_token_type_COMMENT)
         {
-            darrT_push_back(&pp->buffer_for_peek, token(pp));
+            sdarr_token_push_back(&pp->buffer_for_peek, token(pp));
         }
 
         /* In function-like macro, if there is no '(' next to the  identifier there is no need to expand anything.
@@ -1217,7 +1434,7 @@ static bool try_expand(ac_pp* pp, ac_token* tok)
         {
             ac_token token_after_ident_and_whitespaces = token(pp);
             *pp->current_token = identifier; /* Restore  identifier. */
-            darrT_push_back(&pp->buffer_for_peek, token_after_ident_and_whitespaces);
+            sdarr_token_push_back(&pp->buffer_for_peek, token_after_ident_and_whitespaces);
 
             push_cmd(pp, to_cmd_token_list(&pp->buffer_for_peek));
 
@@ -1238,7 +1455,7 @@ static size_t find_parameter_index(ac_token* token, ac_macro* m)
     size_t param_index = m->params.start;
 
     while (param_index < m->params.end) {
-        ac_token* current_param = darrT_ptr(&m->definition, param_index);
+        ac_token* current_param = m->definition + param_index;
         /* NOTE: Identifiers/keywords are the same. They should have the same string pointer. */
         if (token->ident == current_param->ident) {
             return param_index;
@@ -1251,12 +1468,12 @@ static size_t find_parameter_index(ac_token* token, ac_macro* m)
 
 static const strv todo = STRV("@TODO");
 
-static void concat(ac_pp* pp, darr_token* arr, ac_macro* m, ac_token left, ac_token right)
+static void concat(ac_pp* pp, sdarr_token* arr, ac_macro* m, ac_token left, ac_token right)
 {
     /* Special case: when two empty tokens are concatenated a single empty token is created. */
     if (left.type == ac_token_type_EMPTY && right.type == ac_token_type_EMPTY)
     {
-        darrT_push_back(arr, left);
+        sdarr_token_push_back(arr, left);
         return;
     }
 
@@ -1264,9 +1481,9 @@ static void concat(ac_pp* pp, darr_token* arr, ac_macro* m, ac_token left, ac_to
        Hance, two different '#' are added. */
     if (left.type == ac_token_type_HASH && right.type == ac_token_type_HASH)
     {
-        darrT_push_back(arr, left);
+        sdarr_token_push_back(arr, left);
         right.previous_was_space = false;
-        darrT_push_back(arr, right);
+        sdarr_token_push_back(arr, right);
         return;
     }
 
@@ -1292,7 +1509,7 @@ static void concat(ac_pp* pp, darr_token* arr, ac_macro* m, ac_token left, ac_to
     AC_ASSERT(tok->type != ac_token_type_EOF);
 
     do {
-        darrT_push_back(arr, *tok);
+        sdarr_token_push_back(arr, *tok);
     } while ((tok = ac_lex_goto_next(&pp->lex))->type != ac_token_type_EOF);
 
     /* Restore lexer. */
@@ -1344,23 +1561,23 @@ static ac_token stringize(ac_pp* pp, ac_token* tokens, size_t count)
     return t;
 }
 
-static void push_back_expanded_token(ac_pp* pp, darr_token* arr, ac_macro* m, ac_token token)
+static void push_back_expanded_token(ac_pp* pp, sdarr_token* arr, ac_macro* m, ac_token token)
 {
-    size_t size = darrT_size(arr);
+    size_t size = sdarr_token_size(arr);
 
     if (size)
     {
-        ac_token last = darrT_last(arr);
+        ac_token last = *sdarr_token_last(arr);
         
         /* The previous token was a ##, concatenation needed. */
         if (last.type == ac_token_type_DOUBLE_HASH)
         {
             size_t left_index = size - 2;
-            ac_token left = darrT_at(arr, left_index);
+            ac_token left = sdarr_token_data(arr)[left_index];
             ac_token right = token;
 
             /* Change current size because we want to override the left token and the '##' token. */
-            arr->arr.size = left_index;
+            sdarr_token_resize(arr, left_index);
 
             concat(pp, arr, m, left, right);
             return;
@@ -1373,41 +1590,45 @@ static void push_back_expanded_token(ac_pp* pp, darr_token* arr, ac_macro* m, ac
     {
         token.cannot_expand = true;
     }
-    darrT_push_back(arr, token);
+    sdarr_token_push_back(arr, token);
 }
 
-static void add_empty_arg(darr_token* args, darr_range* ranges)
+static void add_empty_arg(scratch_tokens* args, scratch_ranges* ranges)
 {
     range r = { 0 };
-    r.start = darrT_size(args);
+    r.start = args->size;
     
     {
         /* Add empty token */
         ac_token t = { 0 };
         t.type = ac_token_type_EMPTY;
-        darrT_push_back(args, t);
+        ac_scratch_array_push_back(args, t);
 
         /* Add EOF token */
-        ac_token eof = *ac_token_eof();
-        darrT_push_back(args, eof);
+        ac_token eof = ac_token_eof();
+        ac_scratch_array_push_back(args, eof);
     }
 
-    r.end = darrT_size(args);
+    r.end = args->size;
     /* Add the range. */
-    darrT_push_back(ranges, r);
+    ac_scratch_array_push_back(ranges, r);
 }
 
 static bool expand_macro(ac_pp* pp, ac_token* identifier, ac_macro* m)
 {
     bool result = false;
+    uint64_t start_ns = pp->profile ? ac_time_ns() : ac_trace_begin();
+    size_t produced_token_count = 0;
 
     ac_location loc = location(pp);
 
-    darr_token args; /* @OPT: Use a pool allocator to avoid unncessary malloc/free. */
-    darr_range ranges;  /* @OPT: Use a pool allocator to avoid unncessary malloc/free. */
+    /* Arguments are only needed during the expansion, nested expansions use the scratch memory after them. */
+    ac_scratch scope = ac_scratch_begin();
+    scratch_tokens args;
+    scratch_ranges ranges;
 
-    darrT_init(&args);
-    darrT_init(&ranges);
+    ac_scratch_array_init(&args);
+    ac_scratch_array_init(&ranges);
 
     if (m->is_function_like)
     {
@@ -1456,7 +1677,7 @@ static bool expand_macro(ac_pp* pp, ac_token* identifier, ac_macro* m)
 
                     ac_token t = token(pp);
 
-                    darrT_push_back(&args, t);
+                    ac_scratch_array_push_back(&args, t);
 
                     goto_next_token_from_macro_agrument(pp);
                 }
@@ -1473,7 +1694,7 @@ static bool expand_macro(ac_pp* pp, ac_token* identifier, ac_macro* m)
                     goto_next_token_from_macro_agrument(pp); /* Skip ',' */
                 }
 
-                bool no_token_added = r.start == darrT_size(&args);
+                bool no_token_added = r.start == args.size;
                 if (no_token_added) /* Add empty token if there is no token in the arguments. */
                 {
                     add_empty_arg(&args, &ranges);
@@ -1482,16 +1703,16 @@ static bool expand_macro(ac_pp* pp, ac_token* identifier, ac_macro* m)
                 {
                     /* Add EOF token as sentinel value to be able to know where this sequence of tokens is ending. */
                     /* @FIXME: create a special token to avoid confusion. */
-                    ac_token eof = *ac_token_eof();
-                    darrT_push_back(&args, eof);
+                    ac_token eof = ac_token_eof();
+                    ac_scratch_array_push_back(&args, eof);
 
-                    r.end = darrT_size(&args);
+                    r.end = args.size;
 
                     /* Add range. */
-                    darrT_push_back(&ranges, r);
+                    ac_scratch_array_push_back(&ranges, r);
 
                 }
-                r.start = darrT_size(&args);
+                r.start = args.size;
                 current_param_index += 1;
             }
         }
@@ -1519,6 +1740,8 @@ static bool expand_macro(ac_pp* pp, ac_token* identifier, ac_macro* m)
         }
     }
 
+    pp->stats.expansion_count += 1;
+
     size_t body_count = m->body.end - m->body.start;
     if (body_count <= 0) /* Expand to nothing. */
     {
@@ -1526,45 +1749,45 @@ static bool expand_macro(ac_pp* pp, ac_token* identifier, ac_macro* m)
         goto cleanup;
     }
 
-    darr_token exp; /* @OPT: Use a pool allocator to avoid unncessary malloc/free. */
-    darrT_init(&exp);
+    /* Built on the stack, copied to expansions_arena once its size is known. */
+    sdarr_token exp;
+    sdarr_token_init(&exp);
 
     /* Substitute body and expand arguments. */
 
     for (int i = m->body.start; i < m->body.end; i += 1)
     {
-        ac_token body_token = darrT_at(&m->definition, i);
+        ac_token body_token = m->definition[i];
 
         size_t parameter_index = m->is_function_like ? find_parameter_index(&body_token, m) : -1;
         if (parameter_index != (size_t)(-1)) /* Parameter found. */
         {
-            range original_range = darrT_at(&ranges, parameter_index);
-            AC_ASSERT(darrT_at(&args, original_range.end - 1).type == ac_token_type_EOF);
+            range original_range = ranges.data[parameter_index];
+            AC_ASSERT(args.data[original_range.end - 1].type == ac_token_type_EOF);
             range adjusted_range = { original_range.start, original_range.end - 1 }; /* Adjust range to remove the last EOF. */
 
             /* If the previous tokan was '#' handle stringification. */
-            if (darrT_size(&exp) && darrT_last(&exp).type == ac_token_type_HASH)
+            if (sdarr_token_size(&exp) && sdarr_token_last(&exp)->type == ac_token_type_HASH)
             {
-                ac_token last = darrT_last(&exp);
-                ac_token* tokens = darrT_ptr(&args, adjusted_range.start);
+                ac_token last = *sdarr_token_last(&exp);
+                ac_token* tokens = args.data + adjusted_range.start;
                 size_t token_count = range_size(adjusted_range);
 
-                size_t hash_index = darrT_size(&exp) - 1;
-                exp.arr.size -= 1;
+                sdarr_token_pop_back(&exp);
                 
                 ac_token t = stringize(pp, tokens, token_count);
                 
                 t.previous_was_space = last.previous_was_space;
                 /* Replace '#'  token with the new stringified token*/
-                darrT_push_back(&exp, t);
+                sdarr_token_push_back(&exp, t);
             }
             else
             {
-                bool next_is_double_hash = i + 1 < m->body.end ? darrT_at(&m->definition, i + 1).type == ac_token_type_DOUBLE_HASH : false;
-                bool previous_is_double_hash = i - 1 >= m->body.start ? darrT_at(&m->definition, i - 1).type == ac_token_type_DOUBLE_HASH : false;
+                bool next_is_double_hash = i + 1 < m->body.end ? m->definition[i + 1].type == ac_token_type_DOUBLE_HASH : false;
+                bool previous_is_double_hash = i - 1 >= m->body.start ? m->definition[i - 1].type == ac_token_type_DOUBLE_HASH : false;
 
                 ac_token_cmd list = { 0 };
-                ac_token* tokens = darrT_ptr(&args, original_range.start);
+                ac_token* tokens = args.data + original_range.start;
                 size_t token_count = range_size(original_range);
                 push_cmd(pp, make_cmd_token_list(tokens, token_count));
 
@@ -1612,28 +1835,43 @@ static bool expand_macro(ac_pp* pp, ac_token* identifier, ac_macro* m)
     }
 
     macro_push(pp, m);
-    push_cmd(pp, make_cmd_macro_pop(m, exp));
+
+    /* The commands are popped in reverse order of the allocations, the pop of the macro rewinds the arena. */
+    re_arena_mark mark = re_arena_get_mark(&pp->expansions_arena.arena);
+    push_cmd(pp, make_cmd_macro_pop(m, mark));
 
     /* Only push tokens if there are some. */
-    if (exp.arr.size)
+    if (exp.size)
     {
-        push_cmd(pp, to_cmd_token_list(&exp));
+        ac_token* tokens = (ac_token*)ac_arena_push(&pp->expansions_arena, exp.size * sizeof(ac_token), AC_ALIGNOF(ac_token));
+        memcpy(tokens, exp.data, exp.size * sizeof(ac_token));
+        push_cmd(pp, make_cmd_token_list(tokens, exp.size));
     }
 
+    produced_token_count = exp.size;
+    sdarr_token_destroy(&exp);
     result = true;
 cleanup:
-    darrT_destroy(&args);
-    darrT_destroy(&ranges);
+    ac_scratch_end(scope);
+
+    if (pp->profile)
+    {
+        ac_pp_profile_add_expansion(pp->profile, m->ident, produced_token_count, ac_time_ns() - start_ns);
+    }
+
+    /* Only large expansions are traced to not flood the timeline. */
+    if (produced_token_count >= TRACED_EXPANSION_MIN_TOKEN_COUNT)
+    {
+        ac_trace_end(start_ns, "macro", m->ident->text);
+    }
     return result;
 }
 
 static ac_macro* create_macro(ac_pp* pp, ac_ident* macro_name, ac_location location)
 {
     AC_ASSERT(macro_name);
-    /* @FIXME: ast_arena should be renamed. */
-    ac_macro* m = ac_allocator_allocate(&pp->mgr->ast_arena.allocator, sizeof(ac_macro));
+    ac_macro* m = ac_arena_new_zero(&pp->mgr->preprocessor_arena, ac_macro);
     AC_ASSERT(m);
-    ac_macro_init(m);
     if (m && macro_name) {
         m->ident = macro_name;
     }
@@ -1641,6 +1879,30 @@ static ac_macro* create_macro(ac_pp* pp, ac_ident* macro_name, ac_location locat
     return m;
 }
 
+static ac_macro* macro_of(ac_pp* pp, ac_ident* ident)
+{
+    if (ident->macro_generation != pp->macro_generation)
+    {
+        ident->macro = ac_macro_map_get(&pp->macro_map, ident);
+        ident->macro_generation = (uint32_t)pp->macro_generation;
+    }
+    return ident->macro;
+}
+
+static void set_macro(ac_pp* pp, ac_ident* ident, ac_macro* m)
+{
+    pp->macro_map = ac_macro_map_set(&pp->macro_map, &pp->mgr->macro_map_arena.allocator, ident, m);
+
+    ident->macro = m;
+    ident->macro_generation = (uint32_t)pp->macro_generation;
+}
+
+static void new_macro_generation(ac_pp* pp)
+{
+    pp->mgr->macro_generation += 1;
+    pp->macro_generation = pp->mgr->macro_generation;
+}
+
 static ac_location location(ac_pp* pp)
 {
     return pp->lex.location;
@@ -1670,20 +1932,20 @@ static ac_token_cmd make_cmd_token_list(ac_token* data, size_t count)
     return cmd;
 }
 
-static ac_token_cmd make_cmd_macro_pop(ac_macro* m, darr_token tokens)
+static ac_token_cmd make_cmd_macro_pop(ac_macro* m, re_arena_mark mark)
 {
     ac_token_cmd cmd = { 0 };
     cmd.type = ac_token_cmd_type_MACRO_POP;
     cmd.macro_pop.macro = m;
-    cmd.macro_pop.tokens = tokens;
+    cmd.macro_pop.mark = mark;
     return cmd;
 }
 
-static ac_token_cmd to_cmd_token_list(darr_token* arr)
+static ac_token_cmd to_cmd_token_list(sdarr_token* arr)
 {
     ac_token_cmd cmd = { 0 };
-    cmd.token_list.data = arr->arr.data;
-    cmd.token_list.count = arr->arr.size;
+    cmd.token_list.data = sdarr_token_data(arr);
+    cmd.token_list.count = sdarr_token_size(arr);
     return cmd;
 }
 
@@ -1759,7 +2021,12 @@ static eval_t eval_primary(ac_pp* pp)
             break;
         }
 
-        bool macro_exist = token_ptr(pp)->ident->macro != NULL;
+        if (pp->eval_is_recording)
+        {
+            record_eval_dependency(pp, token_ptr(pp));
+        }
+
+        bool macro_exist = macro_of(pp, token_ptr(pp)->ident) != NULL;
         result.value = macro_exist;
 
         goto_next_for_eval(pp); /* Skip identifier. */
@@ -1935,7 +2202,12 @@ static eval_t eval_expr(ac_pp* pp, bool expect_identifier_expression)
         }
         else
         {
-            bool macro_exist = token_ptr(pp)->ident->macro != NULL;
+            if (pp->eval_is_recording)
+            {
+                record_eval_dependency(pp, token_ptr(pp));
+            }
+
+            bool macro_exist = macro_of(pp, token_ptr(pp)->ident) != NULL;
             eval.value = macro_exist;
             goto_next_for_eval(pp); /* Skip identifier. */
         }
@@ -2006,7 +2278,100 @@ static bool branch_was_enabled(ac_pp* pp)
     return pp->if_else_stack[pp->if_else_level].was_enabled;
 }
 
-static void push_include_stack(ac_pp* pp, strv content, strv filepath)
+static const char* eval_memo_key(ac_pp* pp)
+{
+    /* Only the content of files from the manager is guaranteed to stay at the same address.
+       Directives coming from the stack of tokens cannot be identified by a position. */
+    if (pp->lex.entry == NULL || darrT_size(&pp->cmd_stack) != 0)
+    {
+        return NULL;
+    }
+
+    return pp->lex.cur;
+}
+
+static ac_eval_memo* find_valid_eval_memo(ac_pp* pp, const char* key)
+{
+    ac_eval_memo lookup = { .key = key };
+    ac_eval_memo* memo = ac_eval_memo_table_get_item(&pp->eval_memos, &lookup);
+    if (memo == NULL)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < memo->dependency_count; i += 1)
+    {
+        ac_eval_dependency* d = darrT_ptr(&pp->eval_dependencies, memo->dependency_index + i);
+        if (macro_of(pp, d->ident) != d->macro)
+        {
+            return NULL;
+        }
+    }
+
+    return memo;
+}
+
+static void begin_eval_recording(ac_pp* pp)
+{
+    AC_ASSERT(!pp->eval_is_recording);
+
+    pp->eval_is_recording = true;
+    pp->eval_is_memoizable = true;
+    pp->current_eval_dependency_index = darrT_size(&pp->eval_dependencies);
+}
+
+static void end_eval_recording(ac_pp* pp, const char* key, eval_t eval)
+{
+    if (!pp->eval_is_recording)
+    {
+        return;
+    }
+
+    pp->eval_is_recording = false;
+
+    size_t index = pp->current_eval_dependency_index;
+    size_t count = darrT_size(&pp->eval_dependencies) - index;
+
+    if (!eval.succes || !pp->eval_is_memoizable)
+    {
+        darrT_resize(&pp->eval_dependencies, index); /* Discard dependencies. */
+        return;
+    }
+
+    ac_eval_memo memo = {
+        .key = key,
+        .value = eval.value != 0,
+        .dependency_index = index,
+        .dependency_count = count,
+    };
+
+    /* Replace the outdated result.
+       @OPT: dependencies of the outdated result are not reused. */
+    ac_eval_memo* existing = ac_eval_memo_table_get_item(&pp->eval_memos, &memo);
+    if (existing)
+    {
+        *existing = memo;
+    }
+    else
+    {
+        ac_eval_memo_table_insert(&pp->eval_memos, &memo);
+    }
+}
+
+static void record_eval_dependency(ac_pp* pp, ac_token* tok)
+{
+    /* The value of those identifiers does not only depend on macro definitions. */
+    if (tok->type >= ac_token_type__FILE__ && tok->type <= ac_token_type__PRETTY_FUNCTION__)
+    {
+        pp->eval_is_memoizable = false;
+        return;
+    }
+
+    ac_eval_dependency d = { .ident = tok->ident, .macro = macro_of(pp, tok->ident) };
+    darrT_push_back(&pp->eval_dependencies, d);
+}
+
+static void push_include_stack(ac_pp* pp, ac_source_file* src_file)
 {
     ac_lex_state state = ac_lex_save(&pp->lex);
     
@@ -2014,12 +2379,35 @@ static void push_include_stack(ac_pp* pp, strv content, strv filepath)
 
     pp->include_stack[pp->include_stack_depth].starting_if_else_level = pp->if_else_level;
     pp->include_stack[pp->include_stack_depth].lex_state = state;
+    pp->include_stack[pp->include_stack_depth].filepath = src_file->filepath;
+    pp->include_stack[pp->include_stack_depth].trace_ns = ac_trace_begin();
 
-    ac_lex_set_content(&pp->lex, content, filepath);
+    pp->stats.include_count += 1;
+    pp->stats.byte_count += src_file->content.size;
+
+    if (pp->profile)
+    {
+        ac_pp_profile_enter_file(pp->profile, src_file->filepath, src_file->content.size);
+    }
+
+    ac_lex_set_content(&pp->lex, src_file->content, src_file->filepath);
+    pp->lex.entry = src_file->entry;
 }
 
 static void pop_include_stack(ac_pp* pp)
 {
+    pp->stats.line_count += pp->lex.location.row;
+
+    if (pp->profile)
+    {
+        ac_pp_profile_leave_file(pp->profile);
+    }
+
+    if (pp->include_stack[pp->include_stack_depth].trace_ns)
+    {
+        ac_trace_end(pp->include_stack[pp->include_stack_depth].trace_ns, "include", pp->include_stack[pp->include_stack_depth].filepath);
+    }
+
     ac_lex_restore(&pp->lex, &pp->include_stack[pp->include_stack_depth].lex_state);
 
     pp->include_stack_depth -= 1;
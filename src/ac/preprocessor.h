@@ -2,6 +2,7 @@
 #define AC_PREPROCESSOR_H
 
 #include "lexer.h"
+#include "pp_profile.h"
 #include "re_lib.h"
 
 #ifdef __cplusplus
@@ -12,6 +13,32 @@ typedef struct ac_macro ac_macro;
 
 typedef darrT(ac_token) darr_token;
 
+/* Most expansions and peeked tokens are a handful of tokens, they don't allocate. */
+SDARRT_DECLARE(sdarr_token, ac_token, 16)
+SDARRT_DEFINE(sdarr_token, ac_token)
+
+typedef struct range range;
+struct range {
+	size_t start;
+	size_t end;
+};
+
+struct ac_macro {
+	ac_ident* ident;        /* Name of the macro */
+	/* Example of function-like macro:
+	     #define X(x, y) (x + y)
+	   Example of object-like macro:
+	     #define Y (1 + 2) */
+	bool is_function_like;
+
+	ac_token* definition;    /* Contains tokens from parameters and body. Allocated in the preprocessor arena of the manager. */
+	size_t definition_count;
+	range params;          /* If function-like macro, range of tokens from definition representing the parameters. Parsed at directive-time. */
+	range body;            /* Range of token from definition representing the body. Parsed at directive-time.*/
+
+	ac_location location;
+};
+
 enum ac_token_cmd_type {
 	ac_token_cmd_type_TOKEN_LIST,   /* Expanded tokens coming from macro. */
 	ac_token_cmd_type_MACRO_POP,    /* To make a macro expandable again. */
@@ -36,11 +63,40 @@ struct ac_token_cmd {
 
 		struct {
 			ac_macro* macro;
-			darr_token tokens;
+			re_arena_mark mark; /* Expanded tokens of the macro start at this mark of expansions_arena. */
 		} macro_pop;
 	};
 };
 
+/* Identifier read while evaluating a conditional directive and the macro it was referring to at that time. */
+typedef struct ac_eval_dependency ac_eval_dependency;
+struct ac_eval_dependency {
+	ac_ident* ident;
+	ac_macro* macro;
+};
+
+/* Memoized result of a conditional directive. */
+typedef struct ac_eval_memo ac_eval_memo;
+struct ac_eval_memo {
+	const char* key;         /* Position right after the directive name in the file content. */
+	bool value;              /* Value of the expression, not flipped for #ifndef and #elifndef. */
+	size_t dependency_index; /* First dependency in pp->eval_dependencies. */
+	size_t dependency_count;
+};
+
+HTT_DECLARE(ac_eval_memo_table, ac_eval_memo)
+
+/* Counters updated while preprocessing. Predefines are not taken into account. */
+typedef struct ac_pp_stats ac_pp_stats;
+struct ac_pp_stats {
+	size_t token_count;     /* Number of tokens returned by ac_pp_goto_next. */
+	size_t expansion_count; /* Number of macro expansions. */
+	size_t include_count;   /* Number of files entered via #include. */
+	size_t byte_count;      /* Size of the main file and all included files. */
+	size_t line_count;      /* Number of lines of the main file and all included files. */
+	size_t memoized_eval_count; /* Number of conditional directives not evaluated thanks to a previous evaluation. */
+};
+
 typedef struct ac_pp ac_pp;
 struct ac_pp {
 	ac_manager* mgr;
@@ -49,18 +105,31 @@ struct ac_pp {
 
 	/* Stack of list of tokens. It's mostly used for macro but we should be able to add tokens if we peek some next ones. */
 	darrT(ac_token_cmd) cmd_stack;
-	/* Keep a reference of all created macros.
+
+	/* Current macro definitions.
 	   NOTE: It's possible to undefine and redefine a macro while it's being expanded.
-	         This mean we can't destroy the undefine macro right away, hence we keep them forever like defined macros.
+	         This mean we can't destroy the undefine macro right away, hence the manager keeps them forever like defined macros.
 	   @OPT: It's wasteful to keep undefined macro. But at the same time it's not used that much.
 	         It shouldn't have significant impact overall. */
-	darrT(ac_macro*) macros;
+	ac_macro_map macro_map;
+	/* Identifiers with a different generation have an outdated macro cache.
+	   A new generation is given each time the macro map is replaced as a whole. */
+	size_t macro_generation;
 
 	ac_token* current_token;
+	ac_token eof; /* Returned when the preprocessing ends early, on error or when a directive ends it. */
+
+	/* Only directives are processed, the text between them is skipped without being tokenized.
+	   It's used to find the dependencies of a file. */
+	bool directives_only;
 
 	dstr concat_buffer;         /* Concatenation of token is done via tokenizing a string. */
+	darr_token definition_buffer; /* Definition of the macro being parsed, copied to the preprocessor arena once complete. */
 	int macro_depth;            /* Macro depth is not currently needed, it's mostly for inspectiong purpose. */
-	darr_token buffer_for_peek; /* Sometimes we need to peek some tokens and send them on the stack. */
+	sdarr_token buffer_for_peek; /* Sometimes we need to peek some tokens and send them on the stack. */
+	/* Expanded tokens of the macros on the stack. Commands are popped in reverse order,
+	   the arena is rewound when the macro of an expansion is popped. */
+	ac_allocator_arena expansions_arena;
 	int counter_value;
 
 	/* Only allow MAX_DEPTH of nested #if/#else */
@@ -80,16 +149,49 @@ struct ac_pp {
 	struct include_stack {
 		struct ac_lex_state lex_state;
 		int starting_if_else_level;
+		strv filepath;     /* Path of the included file, used to name the trace span. */
+		uint64_t trace_ns; /* Starting time of the trace span, 0 if not traced. */
 	} include_stack[ac_pp_MAX_INCLUDE_DEPTH];
 
 	int include_stack_depth;
+
+	/* Results of conditional directives from files of the manager, keyed by their position in the file content.
+	   A result is reused as long as the identifiers read during the evaluation still refer to the same macros.
+	   NOTE: Macros are never destroyed before the preprocessor, a macro pointer can be used as version of a definition. */
+	ac_eval_memo_table eval_memos;
+	darrT(ac_eval_dependency) eval_dependencies; /* Dependencies of all memoized results. */
+	bool eval_is_recording;    /* True while evaluating an expression which could be memoized. */
+	bool eval_is_memoizable;   /* False if the expression being recorded is using __LINE__, __COUNTER__, etc. */
+	size_t current_eval_dependency_index; /* First dependency of the expression being recorded. */
+
+	ac_pp_stats stats;
+	ac_pp_profile* profile; /* NULL if the preprocessor is not profiled. */
+};
+
+/* State of the macro definitions which can be restored in O(1) by any preprocessor of the same manager.
+   It's meant to share the state after a common prelude of includes. */
+typedef struct ac_pp_checkpoint ac_pp_checkpoint;
+struct ac_pp_checkpoint {
+	ac_macro_map macros;
+	int counter_value;
 };
 
 void ac_pp_init(ac_pp* pp, ac_manager* mgr, strv content, strv filepath);
 void ac_pp_destroy(ac_pp* pp);
 
+ac_pp_checkpoint ac_pp_save_checkpoint(ac_pp* pp);
+/* Must not be called while a macro is being expanded. */
+void ac_pp_restore_checkpoint(ac_pp* pp, const ac_pp_checkpoint* c);
+
+/* Return the tokens before the remaining ones, they are already expanded and must outlive the preprocessor. */
+void ac_pp_push_tokens(ac_pp* pp, ac_token* tokens, size_t count);
+
 ac_token* ac_pp_goto_next(ac_pp* pp);
 
+/* Print the profile in the standard error and write it as JSON in the file given by --profile-preprocessor.
+   Does nothing if the preprocessor is not profiled. */
+bool ac_pp_report_profile(ac_pp* pp);
+
 void ac_pp_preprocess(ac_pp* pp, FILE* file);
 void ac_pp_preprocess_benchmark(ac_pp* pp, FILE* file);
 
@@ -1,4 +1,22 @@
+/* Count the malloc traffic of re.lib, must be defined before re.lib is included. */
+#define DARR_MALLOC(size) ac_counted_malloc(ac_malloc_source_DARR, (size))
+#define DARR_FREE(ptr) ac_counted_free(ac_malloc_source_DARR, (ptr))
+#define DSTR_MALLOC(size) ac_counted_malloc(ac_malloc_source_DSTR, (size))
+#define DSTR_FREE(ptr) ac_counted_free(ac_malloc_source_DSTR, (ptr))
+#define HT_MALLOC(size) ac_counted_malloc(ac_malloc_source_HT, (size))
+#define HT_FREE(ptr) ac_counted_free(ac_malloc_source_HT, (ptr))
+#define RE_AA_MALLOC(size) ac_counted_malloc(ac_malloc_source_ARENA, (size))
+#define RE_AA_FREE(ptr) ac_counted_free(ac_malloc_source_ARENA, (ptr))
+
+/* Count the hash table probes. */
+#ifdef AC_STATS
+#include <stddef.h> /* size_t */
+void ac_stats_ht_probe(size_t probe_length); /* Defined in stats.c */
+#define HT_ON_PROBE ac_stats_ht_probe
+#endif
+
 #include "re_lib.h"
+#include "alloc.h" /* ac_counted_malloc, ac_counted_free */
 
 #define STRV_IMPLEMENTATION
 #include <re/strv.h>
@@ -25,4 +43,23 @@
 
 #define HT_IMPLEMENTATION
 #include <re/ht.h>
-#include <re/ht_ptr.h>
\ No newline at end of file
+#include <re/ht_ptr.h>
+void* ac_table_malloc(size_t size)
+{
+    return HT_MALLOC(size);
+}
+
+void ac_table_free(void* ptr)
+{
+    HT_FREE(ptr);
+}
+
+void* ac_darr_malloc(size_t size)
+{
+    return DARR_MALLOC(size);
+}
+
+void ac_darr_free(void* ptr)
+{
+    DARR_FREE(ptr);
+}
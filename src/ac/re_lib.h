@@ -24,5 +24,29 @@
 #include <re/ht.h>
 #include <re/ht_ptr.h>
 
+/* Typed hash tables are expanded in the files using them, they count their malloc traffic and their probes
+   like ht does in re_lib.c. */
+#include <stddef.h> /* size_t */
+void* ac_table_malloc(size_t size); /* Defined in re_lib.c */
+void ac_table_free(void* ptr);      /* Defined in re_lib.c */
+#define HTT_MALLOC ac_table_malloc
+#define HTT_FREE ac_table_free
+#define SWISST_MALLOC ac_table_malloc
+#define SWISST_FREE ac_table_free
+#ifdef AC_STATS
+void ac_stats_ht_probe(size_t probe_length); /* Defined in stats.c */
+#define HTT_ON_PROBE ac_stats_ht_probe
+#define SWISST_ON_PROBE ac_stats_ht_probe
+#endif
+#include <re/htT.h>
+#include <re/swissT.h>
+
+/* Small arrays count their malloc traffic like darr. */
+void* ac_darr_malloc(size_t size); /* Defined in re_lib.c */
+void ac_darr_free(void* ptr);      /* Defined in re_lib.c */
+#define SDARRT_MALLOC ac_darr_malloc
+#define SDARRT_FREE ac_darr_free
+#include <re/sdarrT.h>
+
 #endif /* RE_C_LIB_H */
 
@@ -0,0 +1,76 @@
+#include "stats.h"
+
+#include "thread_pool.h"
+
+AC_THREAD_LOCAL ac_stats ac_stats_local;
+
+static ac_mutex global_stats_lock = AC_MUTEX_INITIALIZER;
+static ac_stats global_stats;
+
+static void print_counter(FILE* file, const char* name, size_t value);
+
+void ac_stats_merge()
+{
+    ac_mutex_lock(&global_stats_lock);
+    global_stats.consumed_char_count += ac_stats_local.consumed_char_count;
+    for (size_t i = 0; i < ac_token_type_COUNT; i += 1)
+    {
+        global_stats.token_counts[i] += ac_stats_local.token_counts[i];
+    }
+    global_stats.intern_hit_count += ac_stats_local.intern_hit_count;
+    global_stats.intern_miss_count += ac_stats_local.intern_miss_count;
+    global_stats.ht_lookup_count += ac_stats_local.ht_lookup_count;
+    global_stats.ht_probe_count += ac_stats_local.ht_probe_count;
+    if (global_stats.ht_max_probe_length < ac_stats_local.ht_max_probe_length)
+        global_stats.ht_max_probe_length = ac_stats_local.ht_max_probe_length;
+    if (global_stats.cmd_stack_max_depth < ac_stats_local.cmd_stack_max_depth)
+        global_stats.cmd_stack_max_depth = ac_stats_local.cmd_stack_max_depth;
+    global_stats.darr_allocation_count += ac_stats_local.darr_allocation_count;
+    global_stats.dstr_allocation_count += ac_stats_local.dstr_allocation_count;
+    global_stats.skipped_byte_count += ac_stats_local.skipped_byte_count;
+    ac_mutex_unlock(&global_stats_lock);
+
+    memset(&ac_stats_local, 0, sizeof(ac_stats));
+}
+
+void ac_stats_print(FILE* file)
+{
+#ifndef AC_STATS
+    fprintf(file, "statistics are not available, the compiler must be built with AC_STATS defined\n");
+    return;
+#endif
+
+    ac_stats* s = &global_stats;
+
+    print_counter(file, "consumed chars", s->consumed_char_count);
+    print_counter(file, "intern hits", s->intern_hit_count);
+    print_counter(file, "intern misses", s->intern_miss_count);
+    print_counter(file, "ht lookups", s->ht_lookup_count);
+    print_counter(file, "ht probes", s->ht_probe_count);
+    print_counter(file, "ht max probe length", s->ht_max_probe_length);
+    print_counter(file, "cmd stack max depth", s->cmd_stack_max_depth);
+    print_counter(file, "darr allocations", s->darr_allocation_count);
+    print_counter(file, "dstr allocations", s->dstr_allocation_count);
+    print_counter(file, "skipped bytes", s->skipped_byte_count);
+
+    fprintf(file, "\ntokens:\n");
+    for (size_t i = 0; i < ac_token_type_COUNT; i += 1)
+    {
+        if (s->token_counts[i])
+        {
+            print_counter(file, ac_token_type_to_str((enum ac_token_type)i), s->token_counts[i]);
+        }
+    }
+}
+
+void ac_stats_ht_probe(size_t probe_length)
+{
+    AC_STATS_ADD(ht_lookup_count, 1);
+    AC_STATS_ADD(ht_probe_count, probe_length);
+    AC_STATS_MAX(ht_max_probe_length, probe_length);
+}
+
+static void print_counter(FILE* file, const char* name, size_t value)
+{
+    fprintf(file, "%-32s %12zu\n", name, value);
+}
@@ -0,0 +1,55 @@
+#ifndef AC_STATS_H
+#define AC_STATS_H
+
+#include <stdio.h>
+
+#include "global.h"
+#include "lexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Counters of the hot paths, only compiled in when AC_STATS is defined.
+    Each thread updates its own counters, they are added to the global ones with ac_stats_merge.
+*/
+
+#ifdef AC_STATS
+#define AC_STATS_ADD(counter, n) (ac_stats_local.counter += (n))
+#define AC_STATS_MAX(counter, n) (ac_stats_local.counter = ac_stats_local.counter < (n) ? (n) : ac_stats_local.counter)
+#else
+#define AC_STATS_ADD(counter, n) ((void)0)
+#define AC_STATS_MAX(counter, n) ((void)0)
+#endif
+
+typedef struct ac_stats ac_stats;
+struct ac_stats {
+    size_t consumed_char_count;                 /* Characters consumed by the lexer. */
+    size_t token_counts[ac_token_type_COUNT];   /* Tokens produced by the lexer by type. */
+    size_t intern_hit_count;                    /* Identifiers already interned. */
+    size_t intern_miss_count;                   /* Identifiers interned for the first time. */
+    size_t ht_lookup_count;
+    size_t ht_probe_count;                      /* Buckets visited by all the lookups. */
+    size_t ht_max_probe_length;
+    size_t cmd_stack_max_depth;                 /* High-water mark of the preprocessor command stack. */
+    size_t darr_allocation_count;               /* Allocations of dynamic arrays. */
+    size_t dstr_allocation_count;               /* Allocations of dynamic strings. */
+    size_t skipped_byte_count;                  /* Bytes jumped over with the skipped #if blocks. */
+};
+
+extern AC_THREAD_LOCAL ac_stats ac_stats_local;
+
+/* Add the counters of the current thread to the global ones, and reset them. */
+void ac_stats_merge();
+/* Print the global counters. */
+void ac_stats_print(FILE* file);
+
+/* Used by re.lib to count the probes. */
+void ac_stats_ht_probe(size_t probe_length);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_STATS_H */
@@ -0,0 +1,255 @@
+#include "thread_pool.h"
+
+#include "alloc.h" /* ac_scratch_release */
+#include <stdlib.h> /* malloc, free */
+
+#if !_WIN32
+#include <unistd.h> /* sysconf */
+#endif
+
+/* Tasks of one thread. The thread takes its tasks from the front, thieves from the back. */
+typedef struct worker worker;
+struct worker {
+    ac_mutex lock;
+    size_t front;
+    size_t back; /* Excluded. */
+    struct pool* pool;
+    size_t index;
+#if _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+typedef struct pool pool;
+struct pool {
+    worker* workers;
+    size_t worker_count;
+    ac_task_function fn;
+    void* user_data;
+};
+
+/* Take a task from the front of the worker, returns false if there is none left. */
+static bool pop_front(worker* w, size_t* task_index);
+/* Take a task from the back of the worker, returns false if there is none left. */
+static bool pop_back(worker* w, size_t* task_index);
+/* Run the tasks of the worker, then the ones stolen from the others. */
+static void run_worker(worker* w);
+
+/* The scratch memory of a thread is released when the thread ends. */
+#if _WIN32
+static DWORD WINAPI thread_main(LPVOID param) { run_worker((worker*)param); ac_scratch_release(); return 0; }
+#else
+static void* thread_main(void* param) { run_worker((worker*)param); ac_scratch_release(); return NULL; }
+#endif
+
+void ac_mutex_lock(ac_mutex* m)
+{
+#if _WIN32
+    AcquireSRWLockExclusive(m);
+#else
+    pthread_mutex_lock(m);
+#endif
+}
+
+void ac_mutex_unlock(ac_mutex* m)
+{
+#if _WIN32
+    ReleaseSRWLockExclusive(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
+}
+
+void ac_rwlock_init(ac_rwlock* l)
+{
+#if _WIN32
+    InitializeSRWLock(l);
+#else
+    pthread_rwlock_init(l, NULL);
+#endif
+}
+
+void ac_rwlock_destroy(ac_rwlock* l)
+{
+#if _WIN32
+    AC_UNUSED(l); /* SRWLOCK has nothing to release. */
+#else
+    pthread_rwlock_destroy(l);
+#endif
+}
+
+void ac_rwlock_read_lock(ac_rwlock* l)
+{
+#if _WIN32
+    AcquireSRWLockShared(l);
+#else
+    pthread_rwlock_rdlock(l);
+#endif
+}
+
+void ac_rwlock_read_unlock(ac_rwlock* l)
+{
+#if _WIN32
+    ReleaseSRWLockShared(l);
+#else
+    pthread_rwlock_unlock(l);
+#endif
+}
+
+void ac_rwlock_write_lock(ac_rwlock* l)
+{
+#if _WIN32
+    AcquireSRWLockExclusive(l);
+#else
+    pthread_rwlock_wrlock(l);
+#endif
+}
+
+void ac_rwlock_write_unlock(ac_rwlock* l)
+{
+#if _WIN32
+    ReleaseSRWLockExclusive(l);
+#else
+    pthread_rwlock_unlock(l);
+#endif
+}
+
+size_t ac_thread_count()
+{
+#if _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long count = (long)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count > 0 ? (size_t)count : 1;
+}
+
+void ac_thread_pool_run(size_t thread_count, size_t task_count, ac_task_function fn, void* user_data)
+{
+    if (thread_count > task_count)
+    {
+        thread_count = task_count;
+    }
+
+    if (thread_count <= 1)
+    {
+        for (size_t i = 0; i < task_count; i += 1)
+        {
+            fn(user_data, i);
+        }
+        return;
+    }
+
+    pool p;
+    p.workers = malloc(sizeof(worker) * thread_count);
+    p.worker_count = thread_count;
+    p.fn = fn;
+    p.user_data = user_data;
+
+    /* Deal contiguous ranges of tasks. */
+    for (size_t i = 0; i < thread_count; i += 1)
+    {
+        ac_mutex unlocked = AC_MUTEX_INITIALIZER;
+        worker* w = &p.workers[i];
+        w->lock = unlocked;
+        w->front = task_count * i / thread_count;
+        w->back = task_count * (i + 1) / thread_count;
+        w->pool = &p;
+        w->index = i;
+    }
+
+    /* The calling thread is the first worker. */
+    for (size_t i = 1; i < thread_count; i += 1)
+    {
+        worker* w = &p.workers[i];
+#if _WIN32
+        w->thread = CreateThread(NULL, 0, thread_main, w, 0, NULL);
+        bool created = w->thread != NULL;
+#else
+        bool created = pthread_create(&w->thread, NULL, thread_main, w) == 0;
+#endif
+        if (!created)
+        {
+            /* Tasks of the worker will be stolen. */
+            w->pool = NULL;
+        }
+    }
+
+    run_worker(&p.workers[0]);
+
+    for (size_t i = 1; i < thread_count; i += 1)
+    {
+        worker* w = &p.workers[i];
+        if (!w->pool)
+        {
+            continue;
+        }
+#if _WIN32
+        WaitForSingleObject(w->thread, INFINITE);
+        CloseHandle(w->thread);
+#else
+        pthread_join(w->thread, NULL);
+#endif
+    }
+
+#if !_WIN32
+    for (size_t i = 0; i < thread_count; i += 1)
+    {
+        pthread_mutex_destroy(&p.workers[i].lock);
+    }
+#endif
+
+    free(p.workers);
+}
+
+static bool pop_front(worker* w, size_t* task_index)
+{
+    ac_mutex_lock(&w->lock);
+    bool found = w->front < w->back;
+    if (found)
+    {
+        *task_index = w->front;
+        w->front += 1;
+    }
+    ac_mutex_unlock(&w->lock);
+    return found;
+}
+
+static bool pop_back(worker* w, size_t* task_index)
+{
+    ac_mutex_lock(&w->lock);
+    bool found = w->front < w->back;
+    if (found)
+    {
+        w->back -= 1;
+        *task_index = w->back;
+    }
+    ac_mutex_unlock(&w->lock);
+    return found;
+}
+
+static void run_worker(worker* w)
+{
+    pool* p = w->pool;
+    size_t task_index;
+
+    while (pop_front(w, &task_index))
+    {
+        p->fn(p->user_data, task_index);
+    }
+
+    /* Steal from the next workers until all of them are empty.
+       Tasks are never added, an empty worker stays empty. */
+    for (size_t i = 1; i < p->worker_count; i += 1)
+    {
+        worker* victim = &p->workers[(w->index + i) % p->worker_count];
+        while (pop_back(victim, &task_index))
+        {
+            p->fn(p->user_data, task_index);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef AC_THREAD_POOL_H
+#define AC_THREAD_POOL_H
+
+#if _WIN32
+#include <windows.h> /* SRWLOCK */
+#else
+#include <pthread.h>
+#endif
+
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if _WIN32
+typedef SRWLOCK ac_mutex;
+#define AC_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+typedef pthread_mutex_t ac_mutex;
+#define AC_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+/* Mutexes are only initialized statically with AC_MUTEX_INITIALIZER. */
+void ac_mutex_lock(ac_mutex* m);
+void ac_mutex_unlock(ac_mutex* m);
+
+/* Lock for data mostly read, readers don't block each other. */
+#if _WIN32
+typedef SRWLOCK ac_rwlock;
+#else
+typedef pthread_rwlock_t ac_rwlock;
+#endif
+
+void ac_rwlock_init(ac_rwlock* l);
+void ac_rwlock_destroy(ac_rwlock* l);
+void ac_rwlock_read_lock(ac_rwlock* l);
+void ac_rwlock_read_unlock(ac_rwlock* l);
+void ac_rwlock_write_lock(ac_rwlock* l);
+void ac_rwlock_write_unlock(ac_rwlock* l);
+
+/* Number of logical cores, at least 1. */
+size_t ac_thread_count();
+
+/*
+    Run the tasks [0, task_count) on 'thread_count' threads, the calling thread included.
+    Tasks are dealt to the threads, a thread that has run all its tasks steals
+    the remaining ones from the other threads. Returns when all tasks have been run.
+*/
+typedef void (*ac_task_function)(void* user_data, size_t task_index);
+void ac_thread_pool_run(size_t thread_count, size_t task_count, ac_task_function fn, void* user_data);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_THREAD_POOL_H */
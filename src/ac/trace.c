@@ -0,0 +1,160 @@
+#include "trace.h"
+
+#include <stdlib.h> /* malloc, free */
+
+#include "re/file.h"
+
+#include "thread_pool.h"
+
+enum {
+    EVENT_CAPACITY = 1 << 16, /* Number of spans kept per thread. */
+};
+
+typedef struct trace_event trace_event;
+struct trace_event {
+    const char* category;
+    const char* name;
+    size_t name_size;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+typedef struct trace_buffer trace_buffer;
+struct trace_buffer {
+    trace_event* events;
+    size_t count;        /* Number of recorded spans, can exceed the capacity. */
+    size_t thread_index;
+    trace_buffer* next;
+};
+
+/* Buffer of the current thread, NULL if it's not recording. */
+static AC_THREAD_LOCAL trace_buffer* current_buffer;
+
+/* Guards the list of buffers, threads register their buffer when they start recording. */
+static ac_mutex buffers_lock = AC_MUTEX_INITIALIZER;
+static trace_buffer* first_buffer;
+static size_t thread_count;
+static uint64_t origin_ns;
+
+static void print_json_string(FILE* file, const char* str, size_t size);
+
+void ac_trace_start()
+{
+    if (current_buffer)
+    {
+        return;
+    }
+
+    trace_buffer* b = malloc(sizeof(trace_buffer));
+    b->events = malloc(sizeof(trace_event) * EVENT_CAPACITY);
+    b->count = 0;
+
+    ac_mutex_lock(&buffers_lock);
+    if (!first_buffer)
+    {
+        origin_ns = ac_time_ns();
+    }
+    b->thread_index = thread_count;
+    b->next = first_buffer;
+
+    thread_count += 1;
+    first_buffer = b;
+    ac_mutex_unlock(&buffers_lock);
+
+    current_buffer = b;
+}
+
+void ac_trace_stop()
+{
+    trace_buffer* b = first_buffer;
+    while (b)
+    {
+        trace_buffer* next = b->next;
+        free(b->events);
+        free(b);
+        b = next;
+    }
+
+    first_buffer = NULL;
+    current_buffer = NULL;
+    thread_count = 0;
+}
+
+bool ac_trace_is_enabled()
+{
+    return current_buffer != NULL;
+}
+
+uint64_t ac_trace_begin()
+{
+    return current_buffer ? ac_time_ns() : 0;
+}
+
+void ac_trace_end(uint64_t start_ns, const char* category, strv name)
+{
+    trace_buffer* b = current_buffer;
+    if (!b)
+    {
+        return;
+    }
+
+    trace_event* e = &b->events[b->count % EVENT_CAPACITY];
+    e->category = category;
+    e->name = name.data;
+    e->name_size = name.size;
+    e->start_ns = start_ns;
+    e->duration_ns = ac_time_ns() - start_ns;
+
+    b->count += 1;
+}
+
+bool ac_trace_write(const char* filepath)
+{
+    FILE* file = re_file_open(filepath, "wb");
+    if (!file)
+    {
+        ac_report_error("could not open '%s' for writing", filepath);
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\": [");
+
+    bool first = true;
+    for (trace_buffer* b = first_buffer; b; b = b->next)
+    {
+        /* Oldest spans have been overwritten if the buffer is full. */
+        size_t start = b->count > EVENT_CAPACITY ? b->count - EVENT_CAPACITY : 0;
+        for (size_t i = start; i < b->count; i += 1)
+        {
+            trace_event* e = &b->events[i % EVENT_CAPACITY];
+            fprintf(file, first ? "\n  {\"name\": " : ",\n  {\"name\": ");
+            print_json_string(file, e->name, e->name_size);
+            fprintf(file, ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %zu}",
+                e->category,
+                (double)(e->start_ns - origin_ns) / 1e3,
+                (double)e->duration_ns / 1e3,
+                b->thread_index + 1);
+            first = false;
+        }
+    }
+
+    fprintf(file, "\n], \"displayTimeUnit\": \"ms\"}\n");
+
+    re_file_close(file);
+    return true;
+}
+
+static void print_json_string(FILE* file, const char* str, size_t size)
+{
+    fputc('"', file);
+    for (size_t i = 0; i < size; i += 1)
+    {
+        char c = str[i];
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(c, file);
+    }
+    fputc('"', file);
+}
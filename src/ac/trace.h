@@ -0,0 +1,36 @@
+#ifndef AC_TRACE_H
+#define AC_TRACE_H
+
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Timeline of the compilation in the trace event format, to be viewed with Perfetto or chrome://tracing.
+    Each thread records its spans into its own ring buffer allocated by ac_trace_start,
+    recording a span never allocates. When the buffer is full the oldest spans are overwritten.
+    Names of the spans are not copied, they must outlive the call to ac_trace_write.
+*/
+
+/* Start recording the spans of the current thread. */
+void ac_trace_start();
+/* Stop recording and release the buffers of all threads. Must be called when no thread is recording. */
+void ac_trace_stop();
+
+bool ac_trace_is_enabled();
+
+/* Returns the starting time of a span, 0 if the current thread is not recording. */
+uint64_t ac_trace_begin();
+/* Record a span started with ac_trace_begin. */
+void ac_trace_end(uint64_t start_ns, const char* category, strv name);
+
+/* Write the spans of all threads. */
+bool ac_trace_write(const char* filepath);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_TRACE_H */
@@ -0,0 +1,1131 @@
+#ifndef AC_BENCH_H
+#define AC_BENCH_H
+
+#include <stdlib.h> /* qsort, strtol */
+
+#include <ac/global.h>
+#include <ac/compiler.h>
+#include <ac/intern.h>
+#include <ac/parser_c.h>
+#include <ac/thread_pool.h>
+#include <ac/re_lib.h>
+
+#include "parse_options.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Benchmark of the main compilation phases.
+    Each phase runs a number of times over all the files with a new manager for each file,
+    the minimum and the median of the total time are reported.
+*/
+
+enum bench_phase {
+    bench_phase_LEX,        /* Lexing only, #include are not followed. */
+    bench_phase_PREPROCESS, /* Preprocessing including all the #include. */
+    bench_phase_PARSE,      /* Preprocessing and parsing. */
+    bench_phase_COUNT
+};
+
+static const char* bench_phase_names[bench_phase_COUNT] = {
+    "lex",
+    "preprocess",
+    "parse",
+};
+
+typedef struct bench_result bench_result;
+struct bench_result {
+    double min_seconds;
+    double median_seconds;
+    size_t token_count;
+    size_t byte_count;
+    size_t identifier_count;
+    size_t literal_count;
+    size_t expansion_count;
+};
+
+typedef struct bench_options bench_options;
+struct bench_options {
+    int iterations;
+    bool json;
+    bool intern;
+    bool hash;
+    bool table;
+    int declarations; /* Parse generated declarations instead of the files if not 0. */
+};
+
+static const struct bench_cli_options {
+    strv declarations;
+    strv hash;
+    strv intern;
+    strv iterations;
+    strv json;
+    strv table;
+} bench_cli_options = {
+    .declarations = STRV("--declarations"),
+    .hash = STRV("--hash"),
+    .intern = STRV("--intern"),
+    .iterations = STRV("--iterations"),
+    .json = STRV("--json"),
+    .table = STRV("--table"),
+};
+
+/* Run one phase over all files once. Counters are overriden by the last run. */
+static bool
+bench_run_phase(ac_options* o, enum bench_phase phase, bench_result* r, double* seconds)
+{
+    uint64_t total_ns = 0;
+
+    r->token_count = 0;
+    r->byte_count = 0;
+    r->identifier_count = 0;
+    r->literal_count = 0;
+    r->expansion_count = 0;
+
+    for (size_t i = 0; i < darrT_size(&o->files); i += 1)
+    {
+        char* filepath = (char*)darrT_at(&o->files, i);
+        bool success = true;
+
+        /* Behave like "ac --preprocess" when only preprocessing. */
+        bool preprocess = o->preprocess;
+        o->preprocess = phase == bench_phase_PREPROCESS;
+
+        ac_manager mgr;
+        ac_manager_init(&mgr, o);
+
+        uint64_t start = ac_time_ns();
+
+        ac_source_file src_file;
+        if (!ac_manager_load_content(&mgr, filepath, &src_file))
+        {
+            ac_manager_destroy(&mgr);
+            o->preprocess = preprocess;
+            return false;
+        }
+
+        switch (phase)
+        {
+        case bench_phase_LEX:
+        {
+            ac_lex lex;
+            ac_lex_init(&lex, &mgr);
+            if (src_file.content.size)
+            {
+                ac_lex_set_content(&lex, src_file.content, src_file.filepath);
+
+                ac_token* t;
+                while ((t = ac_lex_goto_next(&lex))->type != ac_token_type_EOF)
+                {
+                    r->token_count += 1;
+                }
+                success = !t->is_premature_eof;
+            }
+            r->byte_count += src_file.content.size;
+            ac_lex_destroy(&lex);
+            break;
+        }
+        case bench_phase_PREPROCESS:
+        {
+            ac_pp pp;
+            ac_pp_init(&pp, &mgr, src_file.content, src_file.filepath);
+
+            ac_token* t;
+            while ((t = ac_pp_goto_next(&pp))->type != ac_token_type_EOF)
+            {
+            }
+            success = !t->is_premature_eof;
+
+            r->token_count += pp.stats.token_count;
+            r->byte_count += pp.stats.byte_count;
+            r->expansion_count += pp.stats.expansion_count;
+            ac_pp_destroy(&pp);
+            break;
+        }
+        case bench_phase_PARSE:
+        {
+            ac_parser_c parser;
+            ac_parser_c_init(&parser, &mgr, src_file.content, src_file.filepath);
+
+            success = ac_parser_c_parse(&parser);
+
+            r->token_count += parser.pp.stats.token_count;
+            r->byte_count += parser.pp.stats.byte_count;
+            r->expansion_count += parser.pp.stats.expansion_count;
+            ac_parser_c_destroy(&parser);
+            break;
+        }
+        default:
+            AC_ASSERT(0 && "Unreachable");
+        }
+
+        total_ns += ac_time_ns() - start;
+
+        r->identifier_count += ac_ident_table_size(&mgr.identifiers);
+        r->literal_count += ac_string_table_size(&mgr.literals);
+
+        ac_manager_destroy(&mgr);
+
+        o->preprocess = preprocess;
+
+        if (!success)
+        {
+            ac_report_error("benchmark failed during the '%s' phase of '%s'", bench_phase_names[phase], filepath);
+            return false;
+        }
+    }
+
+    *seconds = (double)total_ns / 1e9;
+    return true;
+}
+
+static int
+bench_compare_double(const void* left, const void* right)
+{
+    double l = *(const double*)left;
+    double r = *(const double*)right;
+    return (l > r) - (l < r);
+}
+
+static double
+bench_per_second(double value, double seconds)
+{
+    return seconds > 0.0 ? value / seconds : 0.0;
+}
+
+static void
+bench_print_text(FILE* file, bench_options* bo, bench_result* results, size_t peak_rss)
+{
+    fprintf(file, "%-12s %10s %12s %14s %10s %12s %10s %12s\n",
+        "phase", "min (ms)", "median (ms)", "tokens/s", "MB/s", "identifiers", "literals", "expansions");
+
+    for (int i = 0; i < bench_phase_COUNT; i += 1)
+    {
+        bench_result* r = results + i;
+        fprintf(file, "%-12s %10.3f %12.3f %14.0f %10.2f %12zu %10zu %12zu\n",
+            bench_phase_names[i],
+            r->min_seconds * 1e3,
+            r->median_seconds * 1e3,
+            bench_per_second((double)r->token_count, r->median_seconds),
+            bench_per_second((double)r->byte_count / (1024.0 * 1024.0), r->median_seconds),
+            r->identifier_count,
+            r->literal_count,
+            r->expansion_count);
+    }
+
+    fprintf(file, "\niterations: %d\n", bo->iterations);
+    fprintf(file, "peak RSS:   %.2f MB\n", (double)peak_rss / (1024.0 * 1024.0));
+}
+
+static void
+bench_print_json_string(FILE* file, const char* str)
+{
+    fputc('"', file);
+    for (const char* c = str; *c; c += 1)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static void
+bench_print_json(FILE* file, ac_options* o, bench_options* bo, bench_result* results, size_t peak_rss)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"iterations\": %d,\n", bo->iterations);
+
+    fprintf(file, "  \"files\": [");
+    for (size_t i = 0; i < darrT_size(&o->files); i += 1)
+    {
+        fprintf(file, i ? ", " : "");
+        bench_print_json_string(file, darrT_at(&o->files, i));
+    }
+    fprintf(file, "],\n");
+
+    fprintf(file, "  \"phases\": [\n");
+    for (int i = 0; i < bench_phase_COUNT; i += 1)
+    {
+        bench_result* r = results + i;
+        fprintf(file, "    {\"name\": \"%s\", \"min_ms\": %.3f, \"median_ms\": %.3f, \"tokens\": %zu, \"bytes\": %zu, "
+            "\"tokens_per_second\": %.0f, \"mb_per_second\": %.2f, \"identifiers\": %zu, \"literals\": %zu, \"expansions\": %zu}%s\n",
+            bench_phase_names[i],
+            r->min_seconds * 1e3,
+            r->median_seconds * 1e3,
+            r->token_count,
+            r->byte_count,
+            bench_per_second((double)r->token_count, r->median_seconds),
+            bench_per_second((double)r->byte_count / (1024.0 * 1024.0), r->median_seconds),
+            r->identifier_count,
+            r->literal_count,
+            r->expansion_count,
+            i + 1 < bench_phase_COUNT ? "," : "");
+    }
+    fprintf(file, "  ],\n");
+    fprintf(file, "  \"peak_rss_bytes\": %zu\n", peak_rss);
+    fprintf(file, "}\n");
+}
+
+/*
+    Contention benchmark of the intern table shared by the threads.
+    Each thread interns all identifiers and literals of the files, in the order of the files,
+    starting at a different position. The sharded table is compared to a single table with a single lock.
+*/
+
+static const size_t bench_intern_thread_counts[] = { 1, 4, 16, 64 };
+
+typedef struct bench_word bench_word;
+struct bench_word {
+    strv text;
+    size_t hash;
+    bool is_identifier;
+};
+
+typedef darrT(bench_word) bench_word_array;
+
+/* Collect the identifiers and literals of the files, #include are not followed.
+   The texts are owned by 'mgr'. */
+static bool
+bench_collect_words(ac_manager* mgr, ac_options* o, bench_word_array* words)
+{
+    for (size_t i = 0; i < darrT_size(&o->files); i += 1)
+    {
+        ac_source_file src_file;
+        if (!ac_manager_load_content(mgr, (char*)darrT_at(&o->files, i), &src_file))
+        {
+            return false;
+        }
+
+        ac_lex lex;
+        ac_lex_init(&lex, mgr);
+        if (src_file.content.size)
+        {
+            ac_lex_set_content(&lex, src_file.content, src_file.filepath);
+
+            ac_token* t;
+            while ((t = ac_lex_goto_next(&lex))->type != ac_token_type_EOF)
+            {
+                if (t->type == ac_token_type_IDENTIFIER
+                    || t->type == ac_token_type_LITERAL_STRING
+                    || t->type == ac_token_type_LITERAL_INTEGER)
+                {
+                    bench_word w;
+                    w.text = ac_token_to_strv(*t);
+                    w.hash = ac_hash((char*)w.text.data, w.text.size);
+                    w.is_identifier = t->type == ac_token_type_IDENTIFIER;
+                    darrT_push_back(words, w);
+                }
+            }
+        }
+        ac_lex_destroy(&lex);
+    }
+    return true;
+}
+
+/* Single table guarded by a single lock, the baseline. */
+typedef struct bench_locked_table bench_locked_table;
+struct bench_locked_table {
+    ac_mutex lock;
+    ac_manager mgr; /* Only its literal table and its arena are used. */
+};
+
+typedef struct bench_intern_context bench_intern_context;
+struct bench_intern_context {
+    bench_word_array words;
+    size_t thread_count;
+    ac_intern_table* sharded; /* NULL when the locked table is measured. */
+    bench_locked_table* locked;
+};
+
+static void
+bench_intern_task(bench_intern_context* ctx, size_t thread_index)
+{
+    size_t count = darrT_size(&ctx->words);
+    size_t start = count * thread_index / ctx->thread_count;
+
+    for (size_t i = 0; i < count; i += 1)
+    {
+        bench_word* w = &darrT_at(&ctx->words, (start + i) % count);
+        if (ctx->sharded)
+        {
+            ac_intern_table_get_or_add(ctx->sharded, w->text, w->hash);
+        }
+        else
+        {
+            ac_mutex_lock(&ctx->locked->lock);
+            ac_create_or_reuse_literal_h(&ctx->locked->mgr, w->text, w->hash);
+            ac_mutex_unlock(&ctx->locked->lock);
+        }
+    }
+}
+
+/* Time to intern all words on all threads with a new table. */
+static double
+bench_intern_run(ac_options* o, bench_intern_context* ctx, bool sharded)
+{
+    ac_intern_table* table = NULL;
+    bench_locked_table* locked = NULL;
+    if (sharded)
+    {
+        table = malloc(sizeof(ac_intern_table));
+        ac_intern_table_init(table);
+    }
+    else
+    {
+        ac_mutex unlocked = AC_MUTEX_INITIALIZER;
+        locked = malloc(sizeof(bench_locked_table));
+        locked->lock = unlocked;
+        ac_manager_init(&locked->mgr, o);
+    }
+    ctx->sharded = table;
+    ctx->locked = locked;
+
+    uint64_t start = ac_time_ns();
+    ac_thread_pool_run(ctx->thread_count, ctx->thread_count, (ac_task_function)bench_intern_task, ctx);
+    double seconds = (double)(ac_time_ns() - start) / 1e9;
+
+    if (table)
+    {
+        ac_intern_table_destroy(table);
+        free(table);
+    }
+    if (locked)
+    {
+        ac_manager_destroy(&locked->mgr);
+        free(locked);
+    }
+    return seconds;
+}
+
+static int
+bench_intern(ac_options* o, bench_options* bo)
+{
+    bench_intern_context ctx;
+    darrT_init(&ctx.words);
+
+    ac_manager mgr;
+    ac_manager_init(&mgr, o);
+
+    if (!bench_collect_words(&mgr, o, &ctx.words))
+    {
+        ac_manager_destroy(&mgr);
+        darrT_destroy(&ctx.words);
+        return 1;
+    }
+
+    fprintf(stdout, "%zu words\n\n", darrT_size(&ctx.words));
+    fprintf(stdout, "%-8s %16s %16s %16s %16s\n", "threads", "sharded (ns/op)", "sharded (Mop/s)", "locked (ns/op)", "locked (Mop/s)");
+
+    for (size_t i = 0; i < sizeof(bench_intern_thread_counts) / sizeof(bench_intern_thread_counts[0]); i += 1)
+    {
+        ctx.thread_count = bench_intern_thread_counts[i];
+        double ops = (double)(ctx.thread_count * darrT_size(&ctx.words));
+
+        double sharded_seconds = 0.0;
+        double locked_seconds = 0.0;
+        for (int it = 0; it < bo->iterations; it += 1)
+        {
+            double s = bench_intern_run(o, &ctx, true);
+            double l = bench_intern_run(o, &ctx, false);
+            sharded_seconds = it == 0 || s < sharded_seconds ? s : sharded_seconds;
+            locked_seconds = it == 0 || l < locked_seconds ? l : locked_seconds;
+        }
+
+        fprintf(stdout, "%-8zu %16.2f %16.2f %16.2f %16.2f\n",
+            ctx.thread_count,
+            ops > 0.0 ? sharded_seconds * 1e9 / ops : 0.0,
+            bench_per_second(ops / 1e6, sharded_seconds),
+            ops > 0.0 ? locked_seconds * 1e9 / ops : 0.0,
+            bench_per_second(ops / 1e6, locked_seconds));
+    }
+
+    fprintf(stdout, "\niterations: %d (minimum time)\n", bo->iterations);
+    fprintf(stdout, "cores:      %zu\n", ac_thread_count());
+
+    ac_manager_destroy(&mgr);
+    darrT_destroy(&ctx.words);
+    return 0;
+}
+
+/*
+    Speed and distribution of ac_hash compared to the byte-at-a-time FNV-1 it replaced.
+    Speed is measured on all the identifiers and literals of the files, as the lexer hashes them.
+    Collisions are counted on the distinct ones: on the full hash and on the bucket
+    of a table sized like ht, the smallest power of two with a load below 0.75.
+*/
+
+typedef size_t (*bench_hash_function)(char* str, size_t size);
+
+static size_t
+bench_hash_fnv1(char* str, size_t size)
+{
+    size_t hash = FNV1_OFFSET_BASIS;
+    for (size_t i = 0; i < size; i += 1)
+    {
+        hash = FNV1_HASH(hash, str[i]);
+    }
+    return hash;
+}
+
+static const struct bench_hash_entry {
+    const char* name;
+    bench_hash_function fn;
+} bench_hash_functions[] = {
+    { "fnv1", bench_hash_fnv1 },
+    { "ac_hash", ac_hash },
+};
+
+/* Written so the hashes of the throughput loop are not optimized away. */
+static volatile size_t bench_hash_sink;
+
+static int
+bench_compare_word_text(const void* left, const void* right)
+{
+    strv l = ((const bench_word*)left)->text;
+    strv r = ((const bench_word*)right)->text;
+    int result = memcmp(l.data, r.data, l.size < r.size ? l.size : r.size);
+    return result != 0 ? result : (l.size > r.size) - (l.size < r.size);
+}
+
+static int
+bench_compare_size(const void* left, const void* right)
+{
+    size_t l = *(const size_t*)left;
+    size_t r = *(const size_t*)right;
+    return (l > r) - (l < r);
+}
+
+static double
+bench_power(double base, size_t exponent)
+{
+    double result = 1.0;
+    while (exponent)
+    {
+        if (exponent & 1)
+        {
+            result *= base;
+        }
+        base *= base;
+        exponent >>= 1;
+    }
+    return result;
+}
+
+/* Number of values equal to the previous one once sorted. */
+static size_t
+bench_count_duplicates(size_t* values, size_t count)
+{
+    qsort(values, count, sizeof(size_t), bench_compare_size);
+    size_t duplicates = 0;
+    for (size_t i = 1; i < count; i += 1)
+    {
+        duplicates += values[i] == values[i - 1];
+    }
+    return duplicates;
+}
+
+static int
+bench_hash(ac_options* o, bench_options* bo)
+{
+    bench_word_array words;
+    darrT_init(&words);
+
+    ac_manager mgr;
+    ac_manager_init(&mgr, o);
+
+    if (!bench_collect_words(&mgr, o, &words))
+    {
+        ac_manager_destroy(&mgr);
+        darrT_destroy(&words);
+        return 1;
+    }
+
+    size_t word_count = darrT_size(&words);
+    size_t byte_count = 0;
+    for (size_t i = 0; i < word_count; i += 1)
+    {
+        byte_count += darrT_at(&words, i).text.size;
+    }
+
+    /* Distinct words are kept at the beginning of a sorted copy. */
+    bench_word* distinct = malloc(sizeof(bench_word) * (word_count ? word_count : 1));
+    memcpy(distinct, words.arr.data, sizeof(bench_word) * word_count);
+    qsort(distinct, word_count, sizeof(bench_word), bench_compare_word_text);
+    size_t distinct_count = 0;
+    for (size_t i = 0; i < word_count; i += 1)
+    {
+        if (distinct_count == 0 || !strv_equals(distinct[distinct_count - 1].text, distinct[i].text))
+        {
+            distinct[distinct_count] = distinct[i];
+            distinct_count += 1;
+        }
+    }
+
+    size_t bucket_count = 1;
+    while (bucket_count * 0.75 < distinct_count)
+    {
+        bucket_count *= 2;
+    }
+
+    /* Expected number of items sharing their bucket with a previous one for a uniform hash. */
+    double expected_bucket_collisions = (double)distinct_count
+        - (double)bucket_count * (1.0 - bench_power(1.0 - 1.0 / (double)bucket_count, distinct_count));
+
+    fprintf(stdout, "%zu words, %zu distinct, %.1f bytes on average, %zu buckets\n\n",
+        word_count,
+        distinct_count,
+        word_count ? (double)byte_count / (double)word_count : 0.0,
+        bucket_count);
+    fprintf(stdout, "%-8s %12s %12s %16s %18s\n", "hash", "ns/hash", "MB/s", "hash collisions", "bucket collisions");
+
+    size_t* values = malloc(sizeof(size_t) * (distinct_count ? distinct_count : 1));
+
+    for (size_t f = 0; f < sizeof(bench_hash_functions) / sizeof(bench_hash_functions[0]); f += 1)
+    {
+        bench_hash_function fn = bench_hash_functions[f].fn;
+
+        double seconds = 0.0;
+        for (int it = 0; it < bo->iterations; it += 1)
+        {
+            size_t sum = 0;
+            uint64_t start = ac_time_ns();
+            for (size_t i = 0; i < word_count; i += 1)
+            {
+                bench_word* w = &darrT_at(&words, i);
+                sum += fn((char*)w->text.data, w->text.size);
+            }
+            double s = (double)(ac_time_ns() - start) / 1e9;
+            bench_hash_sink = sum;
+            seconds = it == 0 || s < seconds ? s : seconds;
+        }
+
+        for (size_t i = 0; i < distinct_count; i += 1)
+        {
+            values[i] = fn((char*)distinct[i].text.data, distinct[i].text.size);
+        }
+        size_t hash_collisions = bench_count_duplicates(values, distinct_count);
+
+        for (size_t i = 0; i < distinct_count; i += 1)
+        {
+            values[i] = values[i] & (bucket_count - 1);
+        }
+        size_t bucket_collisions = bench_count_duplicates(values, distinct_count);
+
+        fprintf(stdout, "%-8s %12.2f %12.2f %16zu %18zu\n",
+            bench_hash_functions[f].name,
+            word_count ? seconds * 1e9 / (double)word_count : 0.0,
+            bench_per_second((double)byte_count / (1024.0 * 1024.0), seconds),
+            hash_collisions,
+            bucket_collisions);
+    }
+
+    fprintf(stdout, "\nexpected bucket collisions of a uniform hash: %.1f\n", expected_bucket_collisions);
+    fprintf(stdout, "iterations: %d (minimum time)\n", bo->iterations);
+
+    free(values);
+    free(distinct);
+    ac_manager_destroy(&mgr);
+    darrT_destroy(&words);
+    return 0;
+}
+
+/*
+    Identifier tables: ht, which calls the hash and the comparison through pointers,
+    the robin hood table of htT.h and the swiss table of swissT.h used by the manager.
+    Each table is measured with the identifiers of the files on four patterns:
+    - insert: insert the distinct identifiers in a new table.
+    - hit:    look up every identifier in a table having all of them.
+    - miss:   look up half of the distinct identifiers in a table having the other half.
+    - mixed:  look up every identifier in a new table and insert it when it's new, like the lexer.
+*/
+
+enum bench_table_pattern {
+    bench_table_pattern_INSERT,
+    bench_table_pattern_HIT,
+    bench_table_pattern_MISS,
+    bench_table_pattern_MIXED,
+    bench_table_pattern_COUNT
+};
+
+static const char* bench_table_pattern_names[bench_table_pattern_COUNT] = {
+    "insert",
+    "hit",
+    "miss",
+    "mixed",
+};
+
+typedef struct bench_table_input bench_table_input;
+struct bench_table_input {
+    darrT(ac_ident_holder) distinct;    /* Identifiers of the tables. */
+    darrT(ac_ident_holder) occurrences; /* Keys looked up, with their own ac_ident. */
+    darrT(size_t) distinct_indices;     /* Index in 'distinct' of each occurrence. */
+};
+
+/* Written so the lookups are not optimized away. */
+static volatile size_t bench_table_sink;
+
+/* ht with the API of the typed tables. */
+typedef ht bench_ht;
+
+static ht_hash_t
+bench_ident_hash(ac_ident_holder* i)
+{
+    return i->ident->hash;
+}
+
+static ht_bool
+bench_idents_are_same(ac_ident_holder* left, ac_ident_holder* right)
+{
+    return left->ident->hash == right->ident->hash
+        && strv_equals(left->ident->text, right->ident->text);
+}
+
+static void
+bench_swap_idents(ac_ident_holder* left, ac_ident_holder* right)
+{
+    ac_ident_holder tmp = *left;
+    *left = *right;
+    *right = tmp;
+}
+
+static void
+bench_ht_init(bench_ht* h)
+{
+    ht_init(h,
+        sizeof(ac_ident_holder),
+        (ht_hash_function_t)bench_ident_hash,
+        (ht_predicate_t)bench_idents_are_same,
+        (ht_swap_function_t)bench_swap_idents,
+        0);
+}
+
+static void bench_ht_destroy(bench_ht* h) { ht_destroy(h); }
+static ht_size_t bench_ht_size(const bench_ht* h) { return ht_size(h); }
+static ac_ident_holder* bench_ht_get_item_h(const bench_ht* h, const ac_ident_holder* item, ht_hash_t hash) { return (ac_ident_holder*)ht_get_item_h(h, (void*)item, hash); }
+static ht_bool bench_ht_insert_h(bench_ht* h, const ac_ident_holder* item, ht_hash_t hash) { return ht_insert_h(h, (void*)item, hash); }
+
+HTT_DECLARE(bench_htT, ac_ident_holder)
+HTT_DEFINE(bench_htT, ac_ident_holder, ac_ident_holder_hash, ac_ident_holders_are_same)
+
+/* Define 'table'_bench_pattern, which returns the time of one pattern on a new table. */
+#define BENCH_TABLE_PATTERN(table)                                                        \
+    static double                                                                         \
+    table##_bench_pattern(bench_table_input* in, enum bench_table_pattern pattern)        \
+    {                                                                                     \
+        size_t distinct_count = darrT_size(&in->distinct);                                \
+        size_t occurrence_count = darrT_size(&in->occurrences);                           \
+        ac_ident_holder* distinct = darrT_ptr(&in->distinct, 0);                          \
+        table t;                                                                          \
+        table##_init(&t);                                                                 \
+                                                                                          \
+        /* Table filled before the measure. */                                            \
+        size_t step = pattern == bench_table_pattern_MISS ? 2 : 1;                        \
+        if (pattern == bench_table_pattern_HIT || pattern == bench_table_pattern_MISS)    \
+        {                                                                                 \
+            for (size_t i = 0; i < distinct_count; i += step)                             \
+                table##_insert_h(&t, distinct + i, distinct[i].ident->hash);              \
+        }                                                                                 \
+                                                                                          \
+        size_t found = 0;                                                                 \
+        uint64_t start = ac_time_ns();                                                    \
+        switch (pattern)                                                                  \
+        {                                                                                 \
+        case bench_table_pattern_INSERT:                                                  \
+            for (size_t i = 0; i < distinct_count; i += 1)                                \
+                table##_insert_h(&t, distinct + i, distinct[i].ident->hash);              \
+            break;                                                                        \
+        case bench_table_pattern_HIT:                                                     \
+            for (size_t i = 0; i < occurrence_count; i += 1)                              \
+            {                                                                             \
+                ac_ident_holder* key = darrT_ptr(&in->occurrences, i);                    \
+                found += table##_get_item_h(&t, key, key->ident->hash) != NULL;           \
+            }                                                                             \
+            break;                                                                        \
+        case bench_table_pattern_MISS:                                                    \
+            for (size_t i = 1; i < distinct_count; i += 2)                                \
+                found += table##_get_item_h(&t, distinct + i, distinct[i].ident->hash) != NULL; \
+            break;                                                                        \
+        case bench_table_pattern_MIXED:                                                   \
+            for (size_t i = 0; i < occurrence_count; i += 1)                              \
+            {                                                                             \
+                ac_ident_holder* key = darrT_ptr(&in->occurrences, i);                    \
+                if (table##_get_item_h(&t, key, key->ident->hash))                        \
+                    found += 1;                                                           \
+                else                                                                      \
+                {                                                                         \
+                    ac_ident_holder* holder = distinct + darrT_at(&in->distinct_indices, i); \
+                    table##_insert_h(&t, holder, holder->ident->hash);                    \
+                }                                                                         \
+            }                                                                             \
+            break;                                                                        \
+        default:                                                                          \
+            break;                                                                        \
+        }                                                                                 \
+        double seconds = (double)(ac_time_ns() - start) / 1e9;                            \
+                                                                                          \
+        bench_table_sink = found + table##_size(&t);                                      \
+        table##_destroy(&t);                                                              \
+        return seconds;                                                                   \
+    }
+
+BENCH_TABLE_PATTERN(bench_ht)
+BENCH_TABLE_PATTERN(bench_htT)
+BENCH_TABLE_PATTERN(ac_ident_table)
+
+typedef double (*bench_table_function)(bench_table_input* in, enum bench_table_pattern pattern);
+
+static const struct bench_table_entry {
+    const char* name;
+    bench_table_function fn;
+} bench_tables[] = {
+    { "ht", bench_ht_bench_pattern },
+    { "htT", bench_htT_bench_pattern },
+    { "swissT", ac_ident_table_bench_pattern },
+};
+
+static int
+bench_table(ac_options* o, bench_options* bo)
+{
+    bench_word_array words;
+    darrT_init(&words);
+
+    ac_manager mgr;
+    ac_manager_init(&mgr, o);
+
+    if (!bench_collect_words(&mgr, o, &words))
+    {
+        ac_manager_destroy(&mgr);
+        darrT_destroy(&words);
+        return 1;
+    }
+
+    /* Identifiers of the tables and keys are allocated in this arena. */
+    ac_allocator_arena arena;
+    ac_allocator_arena_init(&arena, 16 * 1024);
+
+    bench_table_input in;
+    darrT_init(&in.distinct);
+    darrT_init(&in.occurrences);
+    darrT_init(&in.distinct_indices);
+
+    ac_ident_table index_of_ident; /* Index in 'distinct' of each identifier, kept in token_type. */
+    ac_ident_table_init(&index_of_ident);
+
+    for (size_t i = 0; i < darrT_size(&words); i += 1)
+    {
+        bench_word* w = &darrT_at(&words, i);
+        if (!w->is_identifier)
+        {
+            continue;
+        }
+
+        ac_ident* key = ac_allocator_allocate(&arena.allocator, sizeof(ac_ident));
+        memset(key, 0, sizeof(ac_ident));
+        key->text = w->text;
+        key->hash = w->hash;
+        ac_ident_holder key_holder = { .ident = key };
+
+        ac_ident_holder* known = ac_ident_table_get_item_h(&index_of_ident, &key_holder, w->hash);
+        size_t index = known ? known->token_type : darrT_size(&in.distinct);
+        if (!known)
+        {
+            ac_ident* ident = ac_allocator_allocate(&arena.allocator, sizeof(ac_ident));
+            *ident = *key;
+            ac_ident_holder holder = { .ident = ident, .token_type = ac_token_type_IDENTIFIER };
+            darrT_push_back(&in.distinct, holder);
+
+            ac_ident_holder index_holder = { .ident = ident, .token_type = index };
+            ac_ident_table_insert_h(&index_of_ident, &index_holder, w->hash);
+        }
+
+        darrT_push_back(&in.occurrences, key_holder);
+        darrT_push_back(&in.distinct_indices, index);
+    }
+    ac_ident_table_destroy(&index_of_ident);
+
+    size_t distinct_count = darrT_size(&in.distinct);
+    size_t occurrence_count = darrT_size(&in.occurrences);
+    size_t op_counts[bench_table_pattern_COUNT] = {
+        distinct_count,
+        occurrence_count,
+        distinct_count / 2,
+        occurrence_count,
+    };
+
+    fprintf(stdout, "%zu identifiers, %zu distinct\n\n", occurrence_count, distinct_count);
+    fprintf(stdout, "%-8s %10s", "pattern", "ops");
+    for (size_t t = 0; t < sizeof(bench_tables) / sizeof(bench_tables[0]); t += 1)
+    {
+        fprintf(stdout, " %10s ns/op", bench_tables[t].name);
+    }
+    fprintf(stdout, "\n");
+
+    if (distinct_count)
+    {
+        for (int pattern = 0; pattern < bench_table_pattern_COUNT; pattern += 1)
+        {
+            fprintf(stdout, "%-8s %10zu", bench_table_pattern_names[pattern], op_counts[pattern]);
+            for (size_t t = 0; t < sizeof(bench_tables) / sizeof(bench_tables[0]); t += 1)
+            {
+                double seconds = 0.0;
+                for (int it = 0; it < bo->iterations; it += 1)
+                {
+                    double s = bench_tables[t].fn(&in, (enum bench_table_pattern)pattern);
+                    seconds = it == 0 || s < seconds ? s : seconds;
+                }
+                fprintf(stdout, " %16.2f", op_counts[pattern] ? seconds * 1e9 / (double)op_counts[pattern] : 0.0);
+            }
+            fprintf(stdout, "\n");
+        }
+    }
+
+    fprintf(stdout, "\niterations: %d (minimum time)\n", bo->iterations);
+
+    darrT_destroy(&in.distinct);
+    darrT_destroy(&in.occurrences);
+    darrT_destroy(&in.distinct_indices);
+    ac_allocator_arena_destroy(&arena);
+    ac_manager_destroy(&mgr);
+    darrT_destroy(&words);
+    return 0;
+}
+
+/*
+    Parser benchmark on generated declarations and function definitions, for each kind of arena.
+    Only parsing is timed, the source is generated in memory once.
+*/
+
+static const struct bench_arena_entry {
+    const char* name;
+    enum ac_arena_kind kind;
+} bench_arena_kinds[] = {
+    { "chunks", ac_arena_kind_CHUNKS },
+    { "virtual", ac_arena_kind_VIRTUAL },
+    { "huge-pages", ac_arena_kind_HUGE_PAGES },
+};
+
+static int
+bench_parser(ac_options* o, bench_options* bo)
+{
+    dstr source;
+    dstr_init(&source);
+    for (int i = 0; i < bo->declarations; i += 1)
+    {
+        dstr_append_f(&source, "int var_%d = %d * 3 + %d, *ptr_%d = &var_%d;\n", i, i, i, i, i);
+        dstr_append_f(&source, "int f_%d(int x, int y)\n{\n    return x + y * %d;\n}\n", i, i);
+    }
+
+    /* Each declaration above is two declarations for the parser. */
+    size_t declaration_count = (size_t)bo->declarations * 2;
+    double* samples = malloc(sizeof(double) * bo->iterations);
+    enum ac_arena_kind arenas = o->arenas;
+    int result = 0;
+
+    fprintf(stdout, "%zu declarations, %zu bytes\n\n", declaration_count, source.size);
+    fprintf(stdout, "%-12s %10s %12s %14s %14s\n", "arenas", "min (ms)", "median (ms)", "ns/decl", "ast bytes");
+
+    for (size_t k = 0; k < sizeof(bench_arena_kinds) / sizeof(bench_arena_kinds[0]); k += 1)
+    {
+        size_t ast_bytes = 0;
+        o->arenas = bench_arena_kinds[k].kind;
+        for (int i = 0; i < bo->iterations; i += 1)
+        {
+            ac_manager mgr;
+            ac_manager_init(&mgr, o);
+
+            uint64_t start = ac_time_ns();
+
+            ac_parser_c parser;
+            ac_parser_c_init(&parser, &mgr, dstr_to_strv(&source), strv_make_from_str("<declarations>"));
+            bool success = ac_parser_c_parse(&parser);
+            ac_parser_c_destroy(&parser);
+
+            samples[i] = (double)(ac_time_ns() - start) / 1e9;
+
+            size_t reserved, chunk_count;
+            ac_allocator_arena_usage(&mgr.ast_arena, &ast_bytes, &reserved, &chunk_count);
+            ac_manager_destroy(&mgr);
+
+            if (!success)
+            {
+                ac_report_error("benchmark failed while parsing the generated declarations");
+                result = 1;
+                goto cleanup;
+            }
+        }
+
+        qsort(samples, bo->iterations, sizeof(double), bench_compare_double);
+        double median = bo->iterations % 2
+            ? samples[bo->iterations / 2]
+            : (samples[bo->iterations / 2 - 1] + samples[bo->iterations / 2]) / 2.0;
+
+        fprintf(stdout, "%-12s %10.3f %12.3f %14.1f %14zu\n",
+            bench_arena_kinds[k].name, samples[0] * 1e3, median * 1e3,
+            samples[0] * 1e9 / (double)declaration_count, ast_bytes);
+    }
+
+    fprintf(stdout, "\niterations: %d\n", bo->iterations);
+
+cleanup:
+    o->arenas = arenas;
+    free(samples);
+    dstr_destroy(&source);
+    return result;
+}
+
+/* Extract benchmark specific arguments, the others are left for parse_options. */
+static bool
+bench_parse_arguments(bench_options* bo, int* argc, char** argv)
+{
+    int remaining = 0;
+    for (int i = 0; i < *argc; i += 1)
+    {
+        char* arg = argv[i];
+        if (arg_equals(arg, bench_cli_options.iterations))
+        {
+            if (i + 1 >= *argc || (bo->iterations = (int)strtol(argv[i + 1], NULL, 10)) <= 0)
+            {
+                ac_report_error("%s expects a positive number.", bench_cli_options.iterations.data);
+                return false;
+            }
+            i += 1;
+        }
+        else if (arg_equals(arg, bench_cli_options.declarations))
+        {
+            if (i + 1 >= *argc || (bo->declarations = (int)strtol(argv[i + 1], NULL, 10)) <= 0)
+            {
+                ac_report_error("%s expects a positive number.", bench_cli_options.declarations.data);
+                return false;
+            }
+            i += 1;
+        }
+        else if (arg_equals(arg, bench_cli_options.json))
+        {
+            bo->json = true;
+        }
+        else if (arg_equals(arg, bench_cli_options.intern))
+        {
+            bo->intern = true;
+        }
+        else if (arg_equals(arg, bench_cli_options.hash))
+        {
+            bo->hash = true;
+        }
+        else if (arg_equals(arg, bench_cli_options.table))
+        {
+            bo->table = true;
+        }
+        else
+        {
+            argv[remaining] = arg;
+            remaining += 1;
+        }
+    }
+    *argc = remaining;
+    return true;
+}
+
+int
+bench(const struct cmd* cmd, int argc, char** argv)
+{
+    AC_UNUSED(cmd);
+
+    pop_args(&argc, &argv); /* Skip "bench". */
+
+    bench_options bo = { .iterations = 10, .json = false };
+    if (!bench_parse_arguments(&bo, &argc, argv))
+    {
+        return 1;
+    }
+
+    if (argc == 0 && !bo.declarations)
+    {
+        ac_report_error("no file to benchmark.");
+        return 1;
+    }
+
+    int result = 1;
+    ac_options options;
+    ac_options_init_default(&options);
+
+    double* samples = NULL;
+
+    if (argc && !parse_options(&options, &argc, &argv))
+    {
+        goto cleanup;
+    }
+
+    if (bo.declarations)
+    {
+        result = bench_parser(&options, &bo);
+        goto cleanup;
+    }
+
+    if (darrT_size(&options.files) == 0)
+    {
+        ac_report_error("no file to benchmark.");
+        goto cleanup;
+    }
+
+    if (bo.intern)
+    {
+        result = bench_intern(&options, &bo);
+        goto cleanup;
+    }
+
+    if (bo.hash)
+    {
+        result = bench_hash(&options, &bo);
+        goto cleanup;
+    }
+
+    if (bo.table)
+    {
+        result = bench_table(&options, &bo);
+        goto cleanup;
+    }
+
+    bench_result results[bench_phase_COUNT] = { 0 };
+    samples = malloc(sizeof(double) * bo.iterations);
+
+    for (int phase = 0; phase < bench_phase_COUNT; phase += 1)
+    {
+        for (int i = 0; i < bo.iterations; i += 1)
+        {
+            if (!bench_run_phase(&options, (enum bench_phase)phase, results + phase, samples + i))
+            {
+                goto cleanup;
+            }
+        }
+
+        qsort(samples, bo.iterations, sizeof(double), bench_compare_double);
+
+        results[phase].min_seconds = samples[0];
+        results[phase].median_seconds = bo.iterations % 2
+            ? samples[bo.iterations / 2]
+            : (samples[bo.iterations / 2 - 1] + samples[bo.iterations / 2]) / 2.0;
+    }
+
+    if (bo.json)
+        bench_print_json(stdout, &options, &bo, results, ac_peak_rss());
+    else
+        bench_print_text(stdout, &bo, results, ac_peak_rss());
+
+    result = 0;
+
+cleanup:
+    free(samples);
+    ac_options_destroy(&options);
+    return result;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AC_BENCH_H */
@@ -24,6 +24,7 @@ struct cmd
 
 int help(const struct cmd* cmd, int argc, char** argv);
 int version(const struct cmd* cmd, int argc, char** argv);
+int bench(const struct cmd* cmd, int argc, char** argv);
 int compile(const struct cmd* cmd, int argc, char** argv);
 int end_command(const struct cmd* cmd, int argc, char** argv) { AC_UNUSED(cmd);  AC_UNUSED(argc);  AC_UNUSED(argv); return 1; }
 
@@ -35,9 +36,12 @@ static const struct cmd default_command =
 static const struct cmd commands[] = {
     {help,    STRV("help"),     "ac help"},
     {version, STRV("version"),  "ac version"},
+    {bench,   STRV("bench"),    "ac bench [--iterations <n>] [--json] [--intern] [--hash] [--table] [--declarations <n>] [options] <files>"},
     {end_command, 0, 0, 0},
 };
 
+#include "bench.h"
+
 int display_help() { help(0, 0, 0); return 1; }
 int display_error(const char* str) { fprintf(stderr, "%s", str); return 1; }
 
@@ -12,30 +12,50 @@ extern "C" {
 #define LITERAL_STRNCOMP(str_ptr, str_literal) strncmp(str_ptr, str_literal, (sizeof(str_literal) - 1))
 
 static const struct options {
+    strv arenas;
     strv colored_output;
     strv debug_parser;
+    strv deps_format;
     strv display_surrounding_lines;
+    strv emit_pch;
+    strv include_pch;
+    strv jobs;
+    strv memory_report;
     strv no_system_specific;
     strv output_extension;
     strv parse_only;
     strv preprocess;
     strv preprocess_benchmark;
     strv preserve_comment;
+    strv profile_preprocessor;
     strv reject_hex_float;
+    strv scan_deps;
+    strv stats;
     strv system_include;
+    strv trace;
     strv user_include;
 } cli_options = {
+    .arenas = STRV("--arenas"),
     .colored_output = STRV("--colored-output"),
     .debug_parser     = STRV("--debug-parser"),
+    .deps_format = STRV("--deps-format"),
     .display_surrounding_lines = STRV("--display-surrounding-lines"),
+    .emit_pch = STRV("--emit-pch"),
+    .include_pch = STRV("--include-pch"),
+    .jobs = STRV("--jobs"),
+    .memory_report = STRV("--memory-report"),
     .no_system_specific = STRV("--no-system-specific"),
     .output_extension = STRV("--output-extension"),
     .parse_only = STRV("--parse-only"),
     .preprocess = STRV("--preprocess"),
     .preprocess_benchmark = STRV("--preprocess-benchmark"),
     .preserve_comment = STRV("--preserve-comment"),
+    .profile_preprocessor = STRV("--profile-preprocessor"),
     .reject_hex_float = STRV("--reject-hex-float"),
+    .scan_deps = STRV("--scan-deps"),
+    .stats = STRV("--stats"),
     .system_include = STRV("--system-include"),
+    .trace = STRV("--trace"),
     .user_include = STRV("--user-include"),
 };
 /*
@@ -67,7 +87,28 @@ parse_from_arguments(ac_options* o, int* argc, char*** argv)
     do {
         char* arg = pop_args(argc, argv);
 
-        if (arg_equals(arg, cli_options.colored_output))
+        if (arg_equals(arg, cli_options.arenas))
+        {
+            arg = pop_args(argc, argv);
+            if (arg && strcmp(arg, "virtual") == 0)
+            {
+                o->arenas = ac_arena_kind_VIRTUAL;
+            }
+            else if (arg && strcmp(arg, "huge-pages") == 0)
+            {
+                o->arenas = ac_arena_kind_HUGE_PAGES;
+            }
+            else if (arg && strcmp(arg, "chunks") == 0)
+            {
+                o->arenas = ac_arena_kind_CHUNKS;
+            }
+            else
+            {
+                ac_report_error("%s expects 'virtual', 'huge-pages' or 'chunks'.", cli_options.arenas.data);
+                return false;
+            }
+        }
+        else if (arg_equals(arg, cli_options.colored_output))
         {
             o->global.colored_output = true;
         }
@@ -76,11 +117,51 @@ parse_from_arguments(ac_options* o, int* argc, char*** argv)
             /* @FIXME it's already true by default. We need to read "true" or "false" from the input. */
             o->debug_parser = true;
         }
+        else if (arg_equals(arg, cli_options.deps_format))
+        {
+            arg = pop_args(argc, argv);
+            if (arg && strcmp(arg, "make") == 0)
+            {
+                o->deps_format = ac_deps_format_MAKE;
+            }
+            else if (arg && strcmp(arg, "json") == 0)
+            {
+                o->deps_format = ac_deps_format_JSON;
+            }
+            else
+            {
+                ac_report_error("%s expects 'make' or 'json'.", cli_options.deps_format.data);
+                return false;
+            }
+        }
         else if (arg_equals(arg, cli_options.display_surrounding_lines))
         {
             /* @FIXME it's already true by default. We need to read "true" or "false" from the input. */
             o->global.display_surrounding_lines = true;
         }
+        else if (arg_equals(arg, cli_options.emit_pch))
+        {
+            o->emit_pch = pop_args(argc, argv);
+        }
+        else if (arg_equals(arg, cli_options.include_pch))
+        {
+            o->include_pch = pop_args(argc, argv);
+        }
+        else if (arg_equals(arg, cli_options.jobs))
+        {
+            arg = pop_args(argc, argv);
+            long jobs = arg ? strtol(arg, NULL, 10) : 0;
+            if (jobs <= 0)
+            {
+                ac_report_error("%s expects a positive number.", cli_options.jobs.data);
+                return false;
+            }
+            o->jobs = (size_t)jobs;
+        }
+        else if (arg_equals(arg, cli_options.memory_report))
+        {
+            o->memory_report = true;
+        }
         else if (arg_equals(arg, cli_options.no_system_specific))
         {
             o->no_system_specific = true;
@@ -105,10 +186,22 @@ parse_from_arguments(ac_options* o, int* argc, char*** argv)
         {
             o->preserve_comment = true;
         }
+        else if (arg_equals(arg, cli_options.profile_preprocessor))
+        {
+            o->profile_preprocessor = pop_args(argc, argv);
+        }
         else if (arg_equals(arg, cli_options.reject_hex_float))
         {
             o->reject_hex_float = true;
         }
+        else if (arg_equals(arg, cli_options.scan_deps))
+        {
+            o->scan_deps = true;
+        }
+        else if (arg_equals(arg, cli_options.stats))
+        {
+            o->stats = true;
+        }
         else if (arg_equals(arg, cli_options.system_include))
         {
             arg = pop_args(argc, argv);
@@ -116,6 +209,10 @@ parse_from_arguments(ac_options* o, int* argc, char*** argv)
                 darrT_push_back(&o->system_includes, strv_make_from_str(arg));
             }
         }
+        else if (arg_equals(arg, cli_options.trace))
+        {
+            o->trace = pop_args(argc, argv);
+        }
         else if (arg_equals(arg, cli_options.user_include))
         {
             arg = pop_args(argc, argv);
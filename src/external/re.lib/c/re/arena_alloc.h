@@ -18,6 +18,10 @@ before you include this file in *one* C or C++ file to create the implementation
 
 Virtual allocation can be used with:
     #define RE_AA_VIRTUAL_ALLOC
+
+An arena can also reserve a large range of addresses once with re_arena_init_virtual,
+the range is committed progressively and its memory is never moved nor copied.
+Allocations that don't fit in the range anymore use regular chunks.
     
 Non-virtual allocation are aligned by default but can be disable with:
     #define RE_AA_ALIGN_MALLOC (0)
@@ -74,6 +78,10 @@ Example of use:
 #define RE_AA_ALIGNMENT (sizeof(void*) * 2)
 #endif
 
+#ifndef RE_AA_HUGE_PAGE_SIZE
+#define RE_AA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
 /* Is ignored if RE_AA_VIRTUAL_ALLOC is used */
 #ifndef RE_AA_ALIGN_MALLOC
 #define RE_AA_ALIGN_MALLOC (1)
@@ -97,25 +105,55 @@ struct re_chunk {
     ptrdiff_t alignment_offset; /* In case of alignment on malloc */
 };
 
+/* Position in an arena, see re_arena_rewind. */
+typedef struct re_arena_mark re_arena_mark;
+struct re_arena_mark {
+    re_chunk* chunk; /* NULL if nothing was allocated. */
+    size_t size;
+};
+
 typedef struct re_arena re_arena;
 struct re_arena {
     re_chunk* first;
     re_chunk* last;
     size_t chunk_min_capacity;
+    size_t reserved_size; /* Size of the range reserved by re_arena_init_virtual, 0 otherwise. */
+    /* Part of the reserved range used before the last clear or rewind. The memory after it,
+       and after the current size of the first chunk, was never used and is still zero. */
+    size_t touched_size;
 };
 
 /* Initialize the arena, this does not allocate anything. */
 RE_AA_API void re_arena_init(re_arena* a, size_t chunk_min_capacity);
 
+/* Initialize the arena and reserve 'reserve_size' bytes of addresses, nothing is committed yet.
+   The memory is committed 'commit_size' bytes at a time, both must be multiples of the page size.
+   Transparent huge pages are requested for the range if 'huge_pages' is not 0, on Linux only.
+   Returns 0 if the range could not be reserved, the arena then uses regular chunks of 'commit_size' bytes. */
+RE_AA_API int re_arena_init_virtual(re_arena* a, size_t reserve_size, size_t commit_size, int huge_pages);
+
 /* Destroy an arena. */
 RE_AA_API void re_arena_destroy(re_arena* a);
 
 /* Clear memory but does not deallocate anything. */
 RE_AA_API void re_arena_clear(re_arena* a);
 
-/* Allocate memory. */
+/* Allocate memory. The memory is not aligned, it directly follows the previous allocation. */
 RE_AA_API void* re_arena_alloc(re_arena* a, size_t byte_size);
 
+/* Allocate memory aligned on 'alignment', which must be a power of two not greater than RE_AA_ALIGNMENT. */
+RE_AA_API void* re_arena_alloc_aligned(re_arena* a, size_t byte_size, size_t alignment);
+
+/* Grow 'ptr' of 'old_size' bytes to 'new_size' bytes. It grows in place if it is the last allocation
+   and if it fits, otherwise new aligned memory is allocated and the content is copied. */
+RE_AA_API void* re_arena_grow(re_arena* a, void* ptr, size_t old_size, size_t new_size, size_t alignment);
+
+/* Current position of the arena. */
+RE_AA_API re_arena_mark re_arena_get_mark(re_arena* a);
+
+/* Release the memory allocated since the mark was taken, the chunks are kept to be reused. */
+RE_AA_API void re_arena_rewind(re_arena* a, re_arena_mark mark);
+
 /* Debug print some internal values. */
 RE_AA_API void re_arena_debug_print(re_arena* a);
 
@@ -123,9 +161,21 @@ RE_AA_API void re_arena_debug_print(re_arena* a);
 
 #ifdef RE_AA_IMPLEMENTATION
 
+#ifdef _WIN32
+#include <windows.h>  /* VirtualAlloc */
+#else
+#include <sys/mman.h> /* mmap */
+#endif
+
 static re_chunk* alloc_chunk(size_t byte_size);
 static void free_chunk(re_chunk* b);
 
+static char* reserve_range(size_t byte_size, int huge_pages);
+static int commit_range(char* data, size_t byte_size);
+static void release_range(char* data, size_t byte_size);
+/* Commit more memory in the reserved range for 'byte_size' bytes, returns 0 if the range is full. */
+static int grow_reserved_chunk(re_arena* a, size_t byte_size);
+
 static int is_power_of_two(size_t v);
 static size_t align_up(size_t v, size_t byte_alignment);
 static size_t compute_capacity_to_allocate(re_arena* a, size_t byte_size);
@@ -139,6 +189,37 @@ re_arena_init(re_arena* a, size_t chunk_min_capacity)
     a->chunk_min_capacity = chunk_min_capacity;
 }
 
+RE_AA_API int
+re_arena_init_virtual(re_arena* a, size_t reserve_size, size_t commit_size, int huge_pages)
+{
+    re_arena_init(a, commit_size);
+
+    char* data = reserve_range(reserve_size, huge_pages);
+    if (data == NULL)
+    {
+        return 0;
+    }
+
+    if (!commit_range(data, commit_size))
+    {
+        release_range(data, reserve_size);
+        return 0;
+    }
+
+    /* The reserved range is the first chunk, its capacity is the committed part. */
+    re_chunk* b = (re_chunk*)data;
+    b->next = NULL;
+    b->alignment_offset = 0;
+    b->size = RE_AA_SIZEOF_CHUNK_ALIGNED;
+    b->capacity = commit_size;
+
+    a->first = b;
+    a->last = b;
+    a->reserved_size = reserve_size;
+    a->touched_size = b->size;
+    return 1;
+}
+
 RE_AA_API void
 re_arena_destroy(re_arena* a)
 {
@@ -147,15 +228,29 @@ re_arena_destroy(re_arena* a)
     {
         re_chunk* to_free = b;
         b = b->next;
-        free_chunk(to_free);
+        if (to_free == a->first && a->reserved_size)
+        {
+            release_range((char*)to_free, a->reserved_size);
+        }
+        else
+        {
+            free_chunk(to_free);
+        }
     }
     a->first = NULL;
     a->last = NULL;
+    a->reserved_size = 0;
+    a->touched_size = 0;
 }
 
 RE_AA_API void
 re_arena_clear(re_arena* a)
 {
+    if (a->reserved_size && a->first->size > a->touched_size)
+    {
+        a->touched_size = a->first->size;
+    }
+
     re_chunk* b = a->first;
     while (b)
     {
@@ -180,6 +275,14 @@ re_arena_alloc(re_arena* a, size_t byte_size)
     }
     else
     {
+        /* The reserved range grows in place before any other chunk is used. */
+        if (a->last == a->first
+            && a->reserved_size
+            && a->last->size + byte_size > a->last->capacity)
+        {
+            grow_reserved_chunk(a, byte_size);
+        }
+
         /* If we want more data than the capacity we go to the next block (if it's not the last). */
         while (a->last->size + byte_size > a->last->capacity
             && a->last->next != NULL)
@@ -204,6 +307,107 @@ re_arena_alloc(re_arena* a, size_t byte_size)
     return (void*)result;
 }
 
+RE_AA_API void*
+re_arena_alloc_aligned(re_arena* a, size_t byte_size, size_t alignment)
+{
+    RE_AA_ASSERT(is_power_of_two(alignment) && alignment <= RE_AA_ALIGNMENT);
+
+    /* Find the first chunk where the padding and the memory fit together, the padding is then added. */
+    while (a->last != NULL)
+    {
+        size_t current = (size_t)((char*)a->last + a->last->size);
+        size_t padding = align_up(current, alignment) - current;
+
+        /* The reserved range grows in place before any other chunk is used. */
+        if (a->last == a->first
+            && a->reserved_size
+            && a->last->size + padding + byte_size > a->last->capacity)
+        {
+            grow_reserved_chunk(a, padding + byte_size);
+        }
+
+        if (a->last->size + padding + byte_size <= a->last->capacity)
+        {
+            a->last->size += padding;
+            break;
+        }
+
+        if (a->last->next == NULL)
+        {
+            /* The chunk is large enough for the memory with any padding. */
+            size_t to_allocate = compute_capacity_to_allocate(a, byte_size + alignment - 1);
+            a->last->next = alloc_chunk(to_allocate);
+        }
+        a->last = a->last->next;
+    }
+
+    return re_arena_alloc(a, byte_size);
+}
+
+RE_AA_API void*
+re_arena_grow(re_arena* a, void* ptr, size_t old_size, size_t new_size, size_t alignment)
+{
+    RE_AA_ASSERT(new_size >= old_size);
+
+    if (ptr != NULL && a->last != NULL
+        && (char*)ptr + old_size == (char*)a->last + a->last->size)
+    {
+        size_t added_size = new_size - old_size;
+        if (a->last == a->first
+            && a->reserved_size
+            && a->last->size + added_size > a->last->capacity)
+        {
+            grow_reserved_chunk(a, added_size);
+        }
+
+        if (a->last->size + added_size <= a->last->capacity)
+        {
+            a->last->size += added_size;
+            return ptr;
+        }
+    }
+
+    void* result = re_arena_alloc_aligned(a, new_size, alignment);
+    if (ptr != NULL && old_size)
+    {
+        memcpy(result, ptr, old_size);
+    }
+    return result;
+}
+
+RE_AA_API re_arena_mark
+re_arena_get_mark(re_arena* a)
+{
+    re_arena_mark mark;
+    mark.chunk = a->last;
+    mark.size = a->last ? a->last->size : 0;
+    return mark;
+}
+
+RE_AA_API void
+re_arena_rewind(re_arena* a, re_arena_mark mark)
+{
+    if (mark.chunk == NULL)
+    {
+        re_arena_clear(a);
+        return;
+    }
+
+    if (a->reserved_size && a->first->size > a->touched_size)
+    {
+        a->touched_size = a->first->size;
+    }
+
+    /* Chunks used after the mark are emptied. */
+    for (re_chunk* b = mark.chunk->next; b; b = b->next)
+    {
+        b->size = RE_AA_SIZEOF_CHUNK_ALIGNED + b->alignment_offset;
+    }
+
+    mark.chunk->size = mark.size;
+    a->last = mark.chunk;
+}
+
 RE_AA_API void
 re_arena_debug_print(re_arena* a)
 {
@@ -285,6 +489,87 @@ alloc_chunk(size_t byte_size)
     return b;
 }
 
+static char*
+reserve_range(size_t byte_size, int huge_pages)
+{
+#ifdef _WIN32
+    (void)huge_pages; /* Large pages need a privilege and must be committed at once on Windows. */
+    return (char*)VirtualAlloc(NULL, byte_size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+
+#ifndef MADV_HUGEPAGE
+    huge_pages = 0;
+#endif
+
+    /* Huge pages are only used for the aligned parts of the range, reserve more to align it. */
+    size_t reserved_size = huge_pages ? byte_size + RE_AA_HUGE_PAGE_SIZE : byte_size;
+    void* data = mmap(NULL, reserved_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages)
+    {
+        char* start = (char*)data;
+        char* aligned = (char*)align_up((size_t)start, RE_AA_HUGE_PAGE_SIZE);
+        if (aligned != start)
+        {
+            munmap(start, aligned - start);
+        }
+        munmap(aligned + byte_size, (start + reserved_size) - (aligned + byte_size));
+        data = aligned;
+
+        /* Only a hint, the range is still usable if the kernel does not support it. */
+        madvise(data, byte_size, MADV_HUGEPAGE);
+    }
+#endif
+    return (char*)data;
+#endif
+}
+
+static int
+commit_range(char* data, size_t byte_size)
+{
+#ifdef _WIN32
+    return VirtualAlloc(data, byte_size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    /* Pages are only backed by physical memory when they are first touched. */
+    return mprotect(data, byte_size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static void
+release_range(char* data, size_t byte_size)
+{
+#ifdef _WIN32
+    (void)byte_size;
+    if (!VirtualFree((LPVOID)data, 0, MEM_RELEASE))
+    {
+        RE_AA_ASSERT(0 && "VirtualFree() failed.");
+    }
+#else
+    int ret = munmap(data, byte_size);
+    RE_AA_ASSERT(ret == 0);
+    (void)ret;
+#endif
+}
+
+static int
+grow_reserved_chunk(re_arena* a, size_t byte_size)
+{
+    re_chunk* b = a->first;
+    size_t capacity = align_up(b->size + byte_size, a->chunk_min_capacity);
+    if (capacity > a->reserved_size
+        || !commit_range((char*)b + b->capacity, capacity - b->capacity))
+    {
+        return 0;
+    }
+    b->capacity = capacity;
+    return 1;
+}
+
 static void
 free_chunk(re_chunk* b)
 {
@@ -325,6 +325,7 @@ DSTR_INTERNAL void  dstr__reserve_no_preserve_data(dstr* s, dstr_size_t new_stri
 DSTR_INTERNAL void  dstr__reserve_internal(dstr* s, dstr_size_t new_string_capacity, dstr_bool preserve_data);
 
 DSTR_INTERNAL int dstr__is_allocated      (dstr* s);
+DSTR_INTERNAL void dstr__terminate        (dstr* s);
 
 DSTR_INTERNAL dstr_bool    dstr__owns_local_buffer     (dstr* s);
 DSTR_INTERNAL dstr_char_t* dstr__get_local_buffer      (dstr* s);
@@ -338,8 +339,9 @@ DSTR_INTERNAL dstr_bool    dstr__is_using_local_buffer (dstr* s);
 
 DSTR_INTERNAL dstr_size_t sizeof_nchar(int count) { return count * sizeof(dstr_char_t); }
 
-/* Shared default value to ensure that s->data is always valid with a '\0' char when a dstr is initialized */
-static dstr_char_t DSTR__DEFAULT_DATA[1] = { '\0' };
+/* Shared default value to ensure that s->data is always valid with a '\0' char when a dstr is initialized.
+   It's read by all the strings of all the threads, it's never written. */
+static const dstr_char_t DSTR__DEFAULT_DATA[1] = { '\0' };
 
 /* returns 150% of the capacity or use the DSTR_MIN_ALLOC value */
 static int
@@ -367,7 +369,7 @@ DSTR_API void
 dstr_init(dstr* s)
 {
     s->size = 0;
-    s->data = DSTR__DEFAULT_DATA;
+    s->data = (dstr_char_t*)DSTR__DEFAULT_DATA;
 	s->capacity = 0;
 	s->local_buffer_size = 0;
 }
@@ -632,7 +634,7 @@ dstr_append_nchar(dstr* s, dstr_size_t count, const dstr_char_t ch)
     }
 
     s->size += count;
-    s->data[s->size] = '\0';
+    dstr__terminate(s);
 }
 
 DSTR_API int
@@ -658,7 +660,7 @@ dstr_append_from(dstr* s, int index, strv sv)
 
 	DSTR_MEMCPY(s->data + index, sv.data, sizeof_nchar(sv.size));
 	s->size = index + sv.size;
-	s->data[s->size] = '\0';
+	dstr__terminate(s);
 }
 
 DSTR_API void
@@ -750,8 +752,8 @@ dstr_assign_nchar(dstr* s, dstr_size_t count, dstr_char_t ch)
         *first = ch;
     }
 
-	s->data[size] = '\0';
 	s->size = size;
+	dstr__terminate(s);
 }
 
 DSTR_API void
@@ -773,6 +775,9 @@ dstr_assign_f(dstr* s, const char* fmt, ...)
 DSTR_API void
 dstr_assign_fv_nogrow(dstr* s, const char* fmt, va_list args)
 {
+	if (s->data == DSTR__DEFAULT_DATA)
+		return; /* Nothing can be written without growing. */
+
 	int size = vsnprintf(s->data, s->capacity + 1, fmt, args);
 	if (size == -1)
 		size = s->capacity;
@@ -879,7 +884,7 @@ dstr_insert(dstr* s, const dstr_it index, strv sv)
 	DSTR_MEMCPY(s->data + offset, sv.data, sizeof_nchar(count));
 
 	s->size += count;
-	s->data[s->size] = '\0';
+	dstr__terminate(s);
 
 	return s->data + offset;
 }
@@ -983,7 +988,7 @@ dstr_resize(dstr* s, dstr_size_t size)
     }
 
     s->size = size;
-    s->data[s->size] = '\0';
+    dstr__terminate(s);
 }
 
 DSTR_API void
@@ -1020,7 +1025,7 @@ dstr_resize_fill(dstr* s, dstr_size_t size, dstr_char_t ch)
 		}
 
 		s->size = size;
-		s->data[s->size] = '\0';
+		dstr__terminate(s);
     }
 }
 
@@ -1149,6 +1154,16 @@ dstr__is_allocated(dstr* s)
     return s->data != dstr__get_local_buffer(s) && s->data != DSTR__DEFAULT_DATA;
 }
 
+/* Write the null terminating char, except in the shared default data which already has it. */
+DSTR_INTERNAL void
+dstr__terminate(dstr* s)
+{
+    if (s->data != DSTR__DEFAULT_DATA)
+    {
+        s->data[s->size] = '\0';
+    }
+}
+
 /* Returns true if the dstr has been built originally with a local buffer */
 DSTR_INTERNAL dstr_bool
 dstr__owns_local_buffer(dstr* s)
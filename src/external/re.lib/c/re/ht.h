@@ -32,6 +32,11 @@
 #define HT_SIZE_T size_t
 #endif
 
+/* Called with the number of buckets visited by each lookup. */
+#ifndef HT_ON_PROBE
+#define HT_ON_PROBE(probe_length) ((void)(probe_length))
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -83,6 +88,7 @@ HT_API void ht_init(ht* h,
     ht_size_t initial_capacity);
 
 HT_API void ht_destroy(ht* h);
+/* Make room for 'item_count' items without growing. */
 HT_API void ht_reserve(ht* h, ht_size_t item_count);
 HT_API void ht_clear(ht* h);
 HT_API void ht_swap(ht* h, ht* other);
@@ -130,6 +136,9 @@ HT_API ht_size_t ht_allocated_memory(const ht* h);
 
 HT_API void ht_debug_print_info(ht* h);
 
+/* Sum and maximum of the distances between the items and their ideal bucket. */
+HT_API void ht_get_displacement(const ht* h, ht_size_t* total, ht_size_t* max);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -170,11 +179,9 @@ bucket_t* ht__bucket_next(const ht* h, bucket_t* bucket)
     return (bucket_t*) ((char*)bucket + h->sizeof_bucket);
 }
 
-static ht_hash_t
-ht__do_hash(const ht* h, const void* item)
+static inline ht_hash_t
+ht__adjust_hash(ht_hash_t hash)
 {
-    ht_hash_t hash = h->hash((void*)item);
-
     /* Adjust hash if it's a reserved hash */
     if (hash == RESERVED_HASH_FOR_EMPTY)
     {
@@ -183,6 +190,12 @@ ht__do_hash(const ht* h, const void* item)
     return hash;
 }
 
+static ht_hash_t
+ht__do_hash(const ht* h, const void* item)
+{
+    return ht__adjust_hash(h->hash((void*)item));
+}
+
 static inline bucket_t*
 ht__bucket_at(const ht* h, ht_size_t index)
 {
@@ -290,13 +303,14 @@ ht__resize_up(ht* h, ht_size_t new_item_capacity)
 
     h->filled_bucket_count = 0;
 
+    /* Buckets keep the hash of their item, there is no need to hash the items again. */
     bucket_t* bucket;
     for (ht_each_bucket(&old_ht, bucket))
     {
         if (!ht__bucket_is_empty(bucket))
         {
             void* item = ht__get_bucket_item(bucket);
-            ht_insert(h, item);
+            ht_insert_h(h, item, bucket->hash);
         }
     }
 
@@ -369,7 +383,17 @@ ht_destroy(ht* h)
 HT_API void
 ht_reserve(ht* h, ht_size_t item_count)
 {
-    ht__resize_up(h, item_count);
+    /* Bucket capacity must stay a power of two, with a load below MAX_LOAD once 'item_count' items are inserted. */
+    ht_size_t bucket_capacity = MIN_CAPACITY;
+    while (bucket_capacity * MAX_LOAD < item_count)
+    {
+        bucket_capacity *= 2;
+    }
+
+    if (bucket_capacity > h->bucket_capacity)
+    {
+        ht__resize_up(h, bucket_capacity);
+    }
 }
 
 HT_API void
@@ -444,20 +468,29 @@ ht__try_find_index(const ht* h, const void* item, ht_hash_t hash, ht_size_t* ind
     if (ht_is_empty(h))
         return 0;
 
+    hash = ht__adjust_hash(hash);
+
     ht_size_t target_bucket_index = ht__bucket_index(h, hash);
     ht_size_t current_bucket_index = target_bucket_index;
+    ht_size_t probe_length = 0;
 
     for (;;)
     {
         bucket_t* current_bucket = ht__bucket_at(h, current_bucket_index);
+        probe_length += 1;
 
         /* If there is no value, we end here. */
-        if (ht__bucket_is_empty(current_bucket)) return 0;
+        if (ht__bucket_is_empty(current_bucket))
+        {
+            HT_ON_PROBE(probe_length);
+            return 0;
+        }
 
         if (current_bucket->hash == hash
             && h->items_are_same(ht__get_bucket_item(current_bucket), (void*)item))
         {
             *index = current_bucket_index;
+            HT_ON_PROBE(probe_length);
             return 1;
         }
 
@@ -467,7 +500,10 @@ ht__try_find_index(const ht* h, const void* item, ht_hash_t hash, ht_size_t* ind
         ht_size_t target_distance = ht__bucket_distance(h, current_bucket_index, target_bucket_index);
 
         if (current_distance < target_distance)
+        {
+            HT_ON_PROBE(probe_length);
             return 0;
+        }
 
         current_bucket_index = ht__bucket_index(h, current_bucket_index + 1);
     }
@@ -541,7 +577,7 @@ ht__insert(ht* h, void* item, ht_hash_t hash, bucket_t** inserted_or_updated)
     }
 
     bucket_t* entry = (bucket_t*)h->tmp_entry;
-    ht__change_value(h, entry, hash, item);
+    ht__change_value(h, entry, ht__adjust_hash(hash), item);
 
     size_t entry_ideal_bucket_index = ht__bucket_index(h, entry->hash);
     size_t current_bucket_index = entry_ideal_bucket_index;
@@ -723,4 +759,23 @@ ht_debug_print_info(ht* h)
     }
 }
 
+HT_API void
+ht_get_displacement(const ht* h, ht_size_t* total, ht_size_t* max)
+{
+    *total = 0;
+    *max = 0;
+
+    for (ht_size_t i = 0; i < h->bucket_capacity; i += 1)
+    {
+        bucket_t* bucket = ht__bucket_at(h, i);
+        if (ht__bucket_is_empty(bucket))
+            continue;
+
+        ht_size_t distance = ht__bucket_distance(h, i, bucket->hash);
+        *total += distance;
+        if (*max < distance)
+            *max = distance;
+    }
+}
+
 #endif /* defined(HT_IMPLEMENTATION) */
\ No newline at end of file
@@ -0,0 +1,266 @@
+/*
+    htT.h - Hash table specialized at compile time, ht.h is required.
+*/
+
+/*
+
+SUMMARY:
+
+    Same robin hood table than ht.h, but the hash, the comparison and the layout of the items
+    are known at compile time: there is no function pointer and items are copied by assignment.
+
+    HTT_DECLARE(name, item_type) declares the table type 'name'.
+    HTT_DEFINE(name, item_type, hash_of, items_are_same) defines the functions of the table:
+
+        void        name_init(name* h);
+        void        name_destroy(name* h);
+        void        name_reserve(name* h, ht_size_t item_count);
+        void        name_clear(name* h);
+        ht_size_t   name_size(const name* h);
+        item_type*  name_get_item(const name* h, const item_type* item);
+        item_type*  name_get_item_h(const name* h, const item_type* item, ht_hash_t hash);
+        ht_bool     name_insert(name* h, const item_type* item);
+        ht_bool     name_insert_h(name* h, const item_type* item, ht_hash_t hash);
+        ht_size_t   name_allocated_memory(const name* h);
+        void        name_get_displacement(const name* h, ht_size_t* total, ht_size_t* max);
+
+    'hash_of(const item_type*)' and 'items_are_same(const item_type*, const item_type*)' can be macros.
+    They are expanded in the functions of the table, the compiler can inline them.
+    Items are compared only when their hash is the same.
+
+    Iterate over the items:
+
+        for (ht_size_t i = 0; i < h.bucket_capacity; i += 1)
+            if (h.buckets[i].hash != 0) ... h.buckets[i].item ...
+*/
+
+#ifndef RE_HTT_H
+#define RE_HTT_H
+
+#include <string.h> /* memset */
+
+#include "ht.h"
+
+/* The functions are expanded where the table is used, the hooks can differ from the ones of ht.h. */
+#ifndef HTT_MALLOC
+#define HTT_MALLOC HT_MALLOC
+#endif
+
+#ifndef HTT_FREE
+#define HTT_FREE HT_FREE
+#endif
+
+#ifndef HTT_ON_PROBE
+#define HTT_ON_PROBE HT_ON_PROBE
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTT_DECLARE(name, item_type)                                         \
+    typedef struct name##_bucket name##_bucket;                              \
+    struct name##_bucket {                                                   \
+        ht_hash_t hash; /* 0 for empty buckets. */                           \
+        item_type item;                                                      \
+    };                                                                       \
+    typedef struct name name;                                                \
+    struct name {                                                            \
+        name##_bucket* buckets;                                              \
+        ht_size_t bucket_capacity;     /* Power of two, or 0. */             \
+        ht_size_t filled_bucket_count;                                       \
+    };
+
+#define HTT_DEFINE(name, item_type, hash_of, items_are_same)                 \
+                                                                             \
+    static inline ht_hash_t                                                  \
+    name##__adjust_hash(ht_hash_t hash)                                      \
+    {                                                                        \
+        /* 0 is reserved for the empty buckets. */                           \
+        return hash == 0 ? 1 : hash;                                         \
+    }                                                                        \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##__index(const name* h, ht_hash_t hash)                             \
+    {                                                                        \
+        return hash & (h->bucket_capacity - 1);                              \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_init(name* h)                                                     \
+    {                                                                        \
+        memset(h, 0, sizeof(name));                                          \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_destroy(name* h)                                                  \
+    {                                                                        \
+        if (h->buckets)                                                      \
+            HTT_FREE(h->buckets);                                            \
+        memset(h, 0, sizeof(name));                                          \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_clear(name* h)                                                    \
+    {                                                                        \
+        if (h->buckets)                                                      \
+            memset(h->buckets, 0, h->bucket_capacity * sizeof(name##_bucket)); \
+        h->filled_bucket_count = 0;                                          \
+    }                                                                        \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##_size(const name* h)                                               \
+    {                                                                        \
+        return h->filled_bucket_count;                                       \
+    }                                                                        \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##_allocated_memory(const name* h)                                   \
+    {                                                                        \
+        return h->bucket_capacity * sizeof(name##_bucket);                   \
+    }                                                                        \
+                                                                             \
+    static inline item_type*                                                 \
+    name##_get_item_h(const name* h, const item_type* item, ht_hash_t hash)  \
+    {                                                                        \
+        if (h->filled_bucket_count == 0)                                     \
+            return 0;                                                        \
+                                                                             \
+        hash = name##__adjust_hash(hash);                                    \
+        ht_size_t target = name##__index(h, hash);                           \
+        ht_size_t index = target;                                            \
+        ht_size_t probe_length = 0;                                          \
+        for (;;)                                                             \
+        {                                                                    \
+            name##_bucket* bucket = h->buckets + index;                      \
+            probe_length += 1;                                               \
+            if (bucket->hash == 0)                                           \
+            {                                                                \
+                HTT_ON_PROBE(probe_length);                                  \
+                return 0;                                                    \
+            }                                                                \
+            if (bucket->hash == hash && items_are_same((&bucket->item), item)) \
+            {                                                                \
+                HTT_ON_PROBE(probe_length);                                  \
+                return &bucket->item;                                        \
+            }                                                                \
+            /* Robin hood: the item would have taken the place of a richer bucket. */ \
+            if (name##__index(h, index - bucket->hash) < name##__index(h, index - target)) \
+            {                                                                \
+                HTT_ON_PROBE(probe_length);                                  \
+                return 0;                                                    \
+            }                                                                \
+            index = name##__index(h, index + 1);                             \
+        }                                                                    \
+    }                                                                        \
+                                                                             \
+    static inline item_type*                                                 \
+    name##_get_item(const name* h, const item_type* item)                    \
+    {                                                                        \
+        return name##_get_item_h(h, item, hash_of(item));                    \
+    }                                                                        \
+                                                                             \
+    /* Place an item that is not in the table, there must be an empty bucket. */ \
+    static inline void                                                       \
+    name##__place(name* h, name##_bucket entry)                              \
+    {                                                                        \
+        ht_size_t ideal = name##__index(h, entry.hash);                      \
+        ht_size_t index = ideal;                                             \
+        for (;;)                                                             \
+        {                                                                    \
+            name##_bucket* bucket = h->buckets + index;                      \
+            if (bucket->hash == 0)                                           \
+            {                                                                \
+                *bucket = entry;                                             \
+                h->filled_bucket_count += 1;                                 \
+                return;                                                      \
+            }                                                                \
+            if (name##__index(h, index - bucket->hash) < name##__index(h, index - ideal)) \
+            {                                                                \
+                name##_bucket richer = *bucket;                              \
+                *bucket = entry;                                             \
+                entry = richer;                                              \
+                ideal = name##__index(h, entry.hash);                        \
+            }                                                                \
+            index = name##__index(h, index + 1);                             \
+        }                                                                    \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##__resize(name* h, ht_size_t bucket_capacity)                       \
+    {                                                                        \
+        name old = *h;                                                       \
+        h->buckets = (name##_bucket*)HTT_MALLOC(bucket_capacity * sizeof(name##_bucket)); \
+        memset(h->buckets, 0, bucket_capacity * sizeof(name##_bucket));      \
+        h->bucket_capacity = bucket_capacity;                                \
+        h->filled_bucket_count = 0;                                          \
+        /* Buckets keep the hash of their item, there is no need to hash the items again. */ \
+        for (ht_size_t i = 0; i < old.bucket_capacity; i += 1)               \
+        {                                                                    \
+            if (old.buckets[i].hash != 0)                                    \
+                name##__place(h, old.buckets[i]);                            \
+        }                                                                    \
+        if (old.buckets)                                                     \
+            HTT_FREE(old.buckets);                                           \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_reserve(name* h, ht_size_t item_count)                            \
+    {                                                                        \
+        /* Same sizing than ht_reserve. */                                   \
+        ht_size_t bucket_capacity = 16;                                      \
+        while (bucket_capacity * 0.75 < item_count)                          \
+            bucket_capacity *= 2;                                            \
+        if (bucket_capacity > h->bucket_capacity)                            \
+            name##__resize(h, bucket_capacity);                              \
+    }                                                                        \
+                                                                             \
+    /* Returns true if item was inserted, false if item was replaced. */     \
+    static inline ht_bool                                                    \
+    name##_insert_h(name* h, const item_type* item, ht_hash_t hash)          \
+    {                                                                        \
+        item_type* existing = name##_get_item_h(h, item, hash);              \
+        if (existing)                                                        \
+        {                                                                    \
+            *existing = *item;                                               \
+            return 0;                                                        \
+        }                                                                    \
+        if (h->bucket_capacity == 0                                          \
+            || h->filled_bucket_count + 1 > h->bucket_capacity * 0.75)       \
+        {                                                                    \
+            name##__resize(h, h->bucket_capacity == 0 ? 16 : h->bucket_capacity * 2); \
+        }                                                                    \
+        name##_bucket entry;                                                 \
+        entry.hash = name##__adjust_hash(hash);                              \
+        entry.item = *item;                                                  \
+        name##__place(h, entry);                                             \
+        return 1;                                                            \
+    }                                                                        \
+                                                                             \
+    static inline ht_bool                                                    \
+    name##_insert(name* h, const item_type* item)                            \
+    {                                                                        \
+        return name##_insert_h(h, item, hash_of(item));                      \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_get_displacement(const name* h, ht_size_t* total, ht_size_t* max) \
+    {                                                                        \
+        *total = 0;                                                          \
+        *max = 0;                                                            \
+        for (ht_size_t i = 0; i < h->bucket_capacity; i += 1)                \
+        {                                                                    \
+            if (h->buckets[i].hash == 0)                                     \
+                continue;                                                    \
+            ht_size_t distance = name##__index(h, i - h->buckets[i].hash);   \
+            *total += distance;                                              \
+            if (*max < distance)                                             \
+                *max = distance;                                             \
+        }                                                                    \
+    }
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RE_HTT_H */
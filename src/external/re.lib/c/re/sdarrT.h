@@ -0,0 +1,143 @@
+/*
+    sdarrT.h - Dynamic array with a small inline buffer, specialized at compile time.
+*/
+
+/*
+
+SUMMARY:
+
+    Same use than darrT, but the first 'inline_capacity' items are stored in the array itself.
+    Memory is only allocated when the array grows beyond them.
+
+    SDARRT_DECLARE(name, item_type, inline_capacity) declares the array type 'name'.
+    SDARRT_DEFINE(name, item_type) defines the functions of the array:
+
+        void        name_init(name* a);
+        void        name_destroy(name* a);
+        void        name_clear(name* a);
+        size_t      name_size(const name* a);
+        item_type*  name_data(name* a);
+        item_type*  name_last(name* a);
+        void        name_push_back(name* a, item_type item);
+        void        name_pop_back(name* a);
+        void        name_resize(name* a, size_t size);   Shrink only.
+
+    The items can point to the array itself: an array must not be copied or moved once initialized.
+*/
+
+#ifndef RE_SDARRT_H
+#define RE_SDARRT_H
+
+#include <stdlib.h> /* size_t */
+#include <string.h> /* memcpy */
+
+#ifndef SDARRT_MALLOC
+#define SDARRT_MALLOC malloc
+#endif
+
+#ifndef SDARRT_FREE
+#define SDARRT_FREE free
+#endif
+
+#ifndef SDARRT_ASSERT
+#include <assert.h>
+#define SDARRT_ASSERT assert
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SDARRT_DECLARE(name, item_type, inline_capacity)                     \
+    typedef struct name name;                                                \
+    struct name {                                                            \
+        item_type* data; /* inline_items until the array grows beyond them. */ \
+        size_t size;                                                         \
+        size_t capacity;                                                     \
+        item_type inline_items[inline_capacity];                             \
+    };
+
+#define SDARRT_DEFINE(name, item_type)                                       \
+                                                                             \
+    static inline void                                                       \
+    name##_init(name* a)                                                     \
+    {                                                                        \
+        a->data = a->inline_items;                                           \
+        a->size = 0;                                                         \
+        a->capacity = sizeof(a->inline_items) / sizeof(a->inline_items[0]);  \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_destroy(name* a)                                                  \
+    {                                                                        \
+        if (a->data != a->inline_items)                                      \
+            SDARRT_FREE(a->data);                                            \
+        name##_init(a);                                                      \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_clear(name* a)                                                    \
+    {                                                                        \
+        a->size = 0;                                                         \
+    }                                                                        \
+                                                                             \
+    static inline size_t                                                     \
+    name##_size(const name* a)                                               \
+    {                                                                        \
+        return a->size;                                                      \
+    }                                                                        \
+                                                                             \
+    static inline item_type*                                                 \
+    name##_data(name* a)                                                     \
+    {                                                                        \
+        return a->data;                                                      \
+    }                                                                        \
+                                                                             \
+    static inline item_type*                                                 \
+    name##_last(name* a)                                                     \
+    {                                                                        \
+        SDARRT_ASSERT(a->size);                                              \
+        return a->data + a->size - 1;                                        \
+    }                                                                        \
+                                                                             \
+    /* Move the items to a larger heap buffer. */                            \
+    static inline void                                                       \
+    name##__grow(name* a)                                                    \
+    {                                                                        \
+        size_t capacity = a->capacity * 2;                                   \
+        item_type* data = (item_type*)SDARRT_MALLOC(capacity * sizeof(item_type)); \
+        memcpy(data, a->data, a->size * sizeof(item_type));                  \
+        if (a->data != a->inline_items)                                      \
+            SDARRT_FREE(a->data);                                            \
+        a->data = data;                                                      \
+        a->capacity = capacity;                                              \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_push_back(name* a, item_type item)                                \
+    {                                                                        \
+        if (a->size == a->capacity)                                          \
+            name##__grow(a);                                                 \
+        a->data[a->size] = item;                                             \
+        a->size += 1;                                                        \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_pop_back(name* a)                                                 \
+    {                                                                        \
+        SDARRT_ASSERT(a->size);                                              \
+        a->size -= 1;                                                        \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_resize(name* a, size_t size)                                      \
+    {                                                                        \
+        SDARRT_ASSERT(size <= a->size);                                      \
+        a->size = size;                                                      \
+    }
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RE_SDARRT_H */
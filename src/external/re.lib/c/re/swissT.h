@@ -0,0 +1,367 @@
+/*
+    swissT.h - Hash table with groups of control bytes specialized at compile time, ht.h is required.
+*/
+
+/*
+
+SUMMARY:
+
+    Open addressing table in the style of the "Swiss tables": each slot has a control byte,
+    either EMPTY or the 7 lowest bits of the hash of its item. The control bytes of a group of 16 slots
+    are compared at once (with SSE2 if available), items are only compared when their 7 bits match.
+    Groups are probed with a triangular sequence, which visits all groups since their count is a power of two.
+
+    The hashes are not stored: 'hash_of' is called again when the table grows.
+    Items which are costly to hash should keep their hash, 'hash_of' then only reads it.
+    Items can't be erased.
+
+    SWISST_DECLARE(name, item_type) declares the table type 'name'.
+    SWISST_DEFINE(name, item_type, hash_of, items_are_same) defines the functions of the table:
+
+        void        name_init(name* h);
+        void        name_destroy(name* h);
+        void        name_reserve(name* h, ht_size_t item_count);
+        void        name_clear(name* h);
+        ht_size_t   name_size(const name* h);
+        ht_size_t   name_capacity(const name* h);
+        item_type*  name_get_item(const name* h, const item_type* item);
+        item_type*  name_get_item_h(const name* h, const item_type* item, ht_hash_t hash);
+        ht_bool     name_insert(name* h, const item_type* item);
+        ht_bool     name_insert_h(name* h, const item_type* item, ht_hash_t hash);
+        ht_size_t   name_allocated_memory(const name* h);
+        void        name_get_displacement(const name* h, ht_size_t* total, ht_size_t* max);
+
+    'hash_of(const item_type*)' and 'items_are_same(const item_type*, const item_type*)' can be macros.
+    The displacement of an item is the number of groups probed before the one holding it.
+
+    Iterate over the items:
+
+        for (ht_size_t i = 0; i < h.capacity; i += 1)
+            if (h.ctrl[i] != SWISST_EMPTY) ... h.slots[i] ...
+*/
+
+#ifndef RE_SWISST_H
+#define RE_SWISST_H
+
+#include <stdint.h> /* uint64_t */
+#include <string.h> /* memset */
+
+#include "ht.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SWISST_SSE2 1
+#include <emmintrin.h>
+#else
+#define SWISST_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h> /* _BitScanForward */
+#endif
+
+/* The functions are expanded where the table is used, the hooks can differ from the ones of ht.h. */
+#ifndef SWISST_MALLOC
+#define SWISST_MALLOC HT_MALLOC
+#endif
+
+#ifndef SWISST_FREE
+#define SWISST_FREE HT_FREE
+#endif
+
+#ifndef SWISST_ON_PROBE
+#define SWISST_ON_PROBE HT_ON_PROBE
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWISST_GROUP_SIZE 16
+#define SWISST_EMPTY 0x80 /* Only control byte with the highest bit set. */
+
+/* One bit per slot of a group. */
+typedef unsigned int swisst_mask;
+
+#if !SWISST_SSE2
+/* Scalar fallback: the 16 control bytes are handled as two 64-bit words. */
+
+static inline uint64_t
+swisst__word(const unsigned char* bytes)
+{
+    uint64_t word = 0;
+    for (int i = 7; i >= 0; i -= 1)
+    {
+        word = (word << 8) | bytes[i]; /* Byte i in bits [8i, 8i+8) whatever the endianness. */
+    }
+    return word;
+}
+
+/* One bit per byte from the words having 0x80 or 0 in each byte. */
+static inline swisst_mask
+swisst__pack(uint64_t low, uint64_t high)
+{
+    const uint64_t gather = 0x0102040810204080ull;
+    return (swisst_mask)(((low >> 7) * gather) >> 56)
+        | (swisst_mask)((((high >> 7) * gather) >> 56) << 8);
+}
+
+/* 0x80 in the bytes of 'word' equal to 0, 0 in the others. */
+static inline uint64_t
+swisst__zero_bytes(uint64_t word)
+{
+    const uint64_t low_bits = 0x7F7F7F7F7F7F7F7Full;
+    return ~(((word & low_bits) + low_bits) | word | low_bits);
+}
+#endif
+
+/* Slots of the group having 'tag' as control byte. */
+static inline swisst_mask
+swisst_match(const unsigned char* group, unsigned char tag)
+{
+#if SWISST_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (swisst_mask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)tag)));
+#else
+    uint64_t tags = 0x0101010101010101ull * tag;
+    return swisst__pack(
+        swisst__zero_bytes(swisst__word(group) ^ tags),
+        swisst__zero_bytes(swisst__word(group + 8) ^ tags));
+#endif
+}
+
+/* Empty slots of the group. */
+static inline swisst_mask
+swisst_match_empty(const unsigned char* group)
+{
+#if SWISST_SSE2
+    return (swisst_mask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    const uint64_t high_bits = 0x8080808080808080ull;
+    return swisst__pack(swisst__word(group) & high_bits, swisst__word(group + 8) & high_bits);
+#endif
+}
+
+/* Index of the lowest bit set, 'mask' must not be 0. */
+static inline unsigned int
+swisst_first(swisst_mask mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    unsigned int index = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        index += 1;
+    }
+    return index;
+#endif
+}
+
+#define SWISST_DECLARE(name, item_type)                                      \
+    typedef struct name name;                                                \
+    struct name {                                                            \
+        item_type* slots;                                                    \
+        unsigned char* ctrl;  /* One control byte per slot, after the slots in the same allocation. */ \
+        ht_size_t capacity;   /* Power of two, at least one group, or 0. */  \
+        ht_size_t count;                                                     \
+    };
+
+#define SWISST_DEFINE(name, item_type, hash_of, items_are_same)              \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##__home_group(const name* h, ht_hash_t hash)                        \
+    {                                                                        \
+        return (hash >> 7) & (h->capacity / SWISST_GROUP_SIZE - 1);          \
+    }                                                                        \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##__next_group(const name* h, ht_size_t group, ht_size_t step)       \
+    {                                                                        \
+        return (group + step) & (h->capacity / SWISST_GROUP_SIZE - 1);       \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_init(name* h)                                                     \
+    {                                                                        \
+        memset(h, 0, sizeof(name));                                          \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_destroy(name* h)                                                  \
+    {                                                                        \
+        if (h->slots)                                                        \
+            SWISST_FREE(h->slots);                                           \
+        memset(h, 0, sizeof(name));                                          \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_clear(name* h)                                                    \
+    {                                                                        \
+        if (h->ctrl)                                                         \
+            memset(h->ctrl, SWISST_EMPTY, h->capacity);                      \
+        h->count = 0;                                                        \
+    }                                                                        \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##_size(const name* h)                                               \
+    {                                                                        \
+        return h->count;                                                     \
+    }                                                                        \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##_capacity(const name* h)                                           \
+    {                                                                        \
+        return h->capacity;                                                  \
+    }                                                                        \
+                                                                             \
+    static inline ht_size_t                                                  \
+    name##_allocated_memory(const name* h)                                   \
+    {                                                                        \
+        return h->capacity * (sizeof(item_type) + 1);                        \
+    }                                                                        \
+                                                                             \
+    static inline item_type*                                                 \
+    name##_get_item_h(const name* h, const item_type* item, ht_hash_t hash)  \
+    {                                                                        \
+        if (h->count == 0)                                                   \
+            return 0;                                                        \
+                                                                             \
+        unsigned char tag = (unsigned char)(hash & 0x7F);                    \
+        ht_size_t group = name##__home_group(h, hash);                       \
+        ht_size_t probe_length = 0;                                          \
+        for (ht_size_t step = 1;; step += 1)                                 \
+        {                                                                    \
+            const unsigned char* ctrl = h->ctrl + group * SWISST_GROUP_SIZE; \
+            probe_length += 1;                                               \
+            swisst_mask match = swisst_match(ctrl, tag);                     \
+            while (match)                                                    \
+            {                                                                \
+                item_type* slot = h->slots + group * SWISST_GROUP_SIZE + swisst_first(match); \
+                if (items_are_same(slot, item))                              \
+                {                                                            \
+                    SWISST_ON_PROBE(probe_length);                           \
+                    return slot;                                             \
+                }                                                            \
+                match &= match - 1;                                          \
+            }                                                                \
+            /* The item would have been placed in this group. */             \
+            if (swisst_match_empty(ctrl))                                    \
+            {                                                                \
+                SWISST_ON_PROBE(probe_length);                               \
+                return 0;                                                    \
+            }                                                                \
+            group = name##__next_group(h, group, step);                      \
+        }                                                                    \
+    }                                                                        \
+                                                                             \
+    static inline item_type*                                                 \
+    name##_get_item(const name* h, const item_type* item)                    \
+    {                                                                        \
+        return name##_get_item_h(h, item, hash_of(item));                    \
+    }                                                                        \
+                                                                             \
+    /* Place an item that is not in the table, there must be an empty slot. */ \
+    static inline item_type*                                                 \
+    name##__place(name* h, const item_type* item, ht_hash_t hash)            \
+    {                                                                        \
+        ht_size_t group = name##__home_group(h, hash);                       \
+        for (ht_size_t step = 1;; step += 1)                                 \
+        {                                                                    \
+            swisst_mask empty = swisst_match_empty(h->ctrl + group * SWISST_GROUP_SIZE); \
+            if (empty)                                                       \
+            {                                                                \
+                ht_size_t index = group * SWISST_GROUP_SIZE + swisst_first(empty); \
+                h->ctrl[index] = (unsigned char)(hash & 0x7F);               \
+                h->slots[index] = *item;                                     \
+                h->count += 1;                                               \
+                return h->slots + index;                                     \
+            }                                                                \
+            group = name##__next_group(h, group, step);                      \
+        }                                                                    \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##__resize(name* h, ht_size_t capacity)                              \
+    {                                                                        \
+        name old = *h;                                                       \
+        h->slots = (item_type*)SWISST_MALLOC(capacity * (sizeof(item_type) + 1)); \
+        h->ctrl = (unsigned char*)(h->slots + capacity);                     \
+        memset(h->ctrl, SWISST_EMPTY, capacity);                             \
+        h->capacity = capacity;                                              \
+        h->count = 0;                                                        \
+        for (ht_size_t i = 0; i < old.capacity; i += 1)                      \
+        {                                                                    \
+            if (old.ctrl[i] != SWISST_EMPTY)                                 \
+                name##__place(h, old.slots + i, hash_of((old.slots + i)));   \
+        }                                                                    \
+        if (old.slots)                                                       \
+            SWISST_FREE(old.slots);                                          \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_reserve(name* h, ht_size_t item_count)                            \
+    {                                                                        \
+        /* Load of 7/8 at most. */                                           \
+        ht_size_t capacity = SWISST_GROUP_SIZE;                              \
+        while (capacity - capacity / 8 < item_count)                         \
+            capacity *= 2;                                                   \
+        if (capacity > h->capacity)                                          \
+            name##__resize(h, capacity);                                     \
+    }                                                                        \
+                                                                             \
+    /* Returns true if item was inserted, false if item was replaced. */     \
+    static inline ht_bool                                                    \
+    name##_insert_h(name* h, const item_type* item, ht_hash_t hash)          \
+    {                                                                        \
+        item_type* existing = name##_get_item_h(h, item, hash);              \
+        if (existing)                                                        \
+        {                                                                    \
+            *existing = *item;                                               \
+            return 0;                                                        \
+        }                                                                    \
+        if (h->count + 1 > h->capacity - h->capacity / 8)                    \
+        {                                                                    \
+            name##__resize(h, h->capacity == 0 ? SWISST_GROUP_SIZE : h->capacity * 2); \
+        }                                                                    \
+        name##__place(h, item, hash);                                        \
+        return 1;                                                            \
+    }                                                                        \
+                                                                             \
+    static inline ht_bool                                                    \
+    name##_insert(name* h, const item_type* item)                            \
+    {                                                                        \
+        return name##_insert_h(h, item, hash_of(item));                      \
+    }                                                                        \
+                                                                             \
+    static inline void                                                       \
+    name##_get_displacement(const name* h, ht_size_t* total, ht_size_t* max) \
+    {                                                                        \
+        *total = 0;                                                          \
+        *max = 0;                                                            \
+        for (ht_size_t i = 0; i < h->capacity; i += 1)                       \
+        {                                                                    \
+            if (h->ctrl[i] == SWISST_EMPTY)                                  \
+                continue;                                                    \
+            ht_size_t group = name##__home_group(h, hash_of((h->slots + i))); \
+            ht_size_t distance = 0;                                          \
+            while (group != i / SWISST_GROUP_SIZE)                           \
+            {                                                                \
+                distance += 1;                                               \
+                group = name##__next_group(h, group, distance);              \
+            }                                                                \
+            *total += distance;                                              \
+            if (*max < distance)                                             \
+                *max = distance;                                             \
+        }                                                                    \
+    }
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RE_SWISST_H */
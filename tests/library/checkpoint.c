@@ -0,0 +1,88 @@
+/*
+    Macro state restored with ac_pp_save_checkpoint and ac_pp_restore_checkpoint.
+    The macros defined after the checkpoint must be gone, the undefined ones must be back,
+    even when the macro cache of the identifiers was filled in between.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ac/preprocessor.h>
+
+static int failure_count = 0;
+
+/* Preprocess 'text' with the current macros and compare the tokens, separated by a space, with 'expected'. */
+static void check(ac_pp* pp, const char* text, const char* expected)
+{
+    ac_lex_set_content(&pp->lex, strv_make_from_str(text), strv_make_from_str("checkpoint.c"));
+
+    dstr actual;
+    dstr_init(&actual);
+
+    ac_token* t;
+    while ((t = ac_pp_goto_next(pp))->type != ac_token_type_EOF)
+    {
+        if (t->type == ac_token_type_HORIZONTAL_WHITESPACE
+            || t->type == ac_token_type_NEW_LINE)
+        {
+            continue;
+        }
+
+        if (actual.size)
+        {
+            dstr_append_char(&actual, ' ');
+        }
+        dstr_append(&actual, ac_token_to_strv(*t));
+    }
+
+    if (t->is_premature_eof || strcmp(actual.data, expected) != 0)
+    {
+        fprintf(stderr, "'%s' expected '%s', actual '%s'\n", text, expected, actual.data);
+        failure_count += 1;
+    }
+
+    dstr_destroy(&actual);
+}
+
+int main()
+{
+    ac_options options;
+    ac_options_init_default(&options);
+    options.no_system_specific = true;
+
+    ac_manager mgr;
+    ac_manager_init(&mgr, &options);
+
+    const char* used = "KEPT REMOVED ADDED __COUNTER__";
+
+    ac_pp pp;
+    ac_pp_init(&pp, &mgr, strv_make_from_str("\n"), strv_make_from_str("checkpoint.c"));
+
+    check(&pp, "#define KEPT 1\n#define REMOVED 2\n", "");
+    check(&pp, used, "1 2 ADDED 0");
+
+    ac_pp_checkpoint c = ac_pp_save_checkpoint(&pp);
+
+    check(&pp, "#undef REMOVED\n#define ADDED 3\n#undef KEPT\n#define KEPT 4\n", "");
+    check(&pp, used, "4 REMOVED 3 1");
+
+    ac_pp_restore_checkpoint(&pp, &c);
+    check(&pp, used, "1 2 ADDED 1");
+
+    ac_pp_destroy(&pp);
+
+    /* Any preprocessor of the same manager can restore the checkpoint. */
+    ac_pp other;
+    ac_pp_init(&other, &mgr, strv_make_from_str("\n"), strv_make_from_str("checkpoint.c"));
+
+    check(&other, used, "KEPT REMOVED ADDED 0");
+    ac_pp_restore_checkpoint(&other, &c);
+    check(&other, used, "1 2 ADDED 1");
+
+    ac_pp_destroy(&other);
+
+    ac_manager_destroy(&mgr);
+    ac_options_destroy(&options);
+
+    return failure_count != 0;
+}
@@ -0,0 +1,6 @@
+#define ADD(a, b) ((a) + (b))
+#define NAME "arenas"
+int main() {
+    const char* name = NAME;
+    return ADD(1, 2);
+}
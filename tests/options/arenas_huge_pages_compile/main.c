@@ -0,0 +1,17 @@
+#define HAS_VALUE
+
+int value1;
+#ifdef HAS_VALUE
+int value2 = 4;
+#else
+int value2 = 0;
+#endif
+
+int main()
+{
+    char *name = "arenas";
+    int a = 1 + 2 * 4;
+    int* b = &a;
+    int result = *b == 9 && value2 == 4 && *name == 'a';
+    return !result; // exit code of 0 (false) means success.
+}
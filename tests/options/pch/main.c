@@ -0,0 +1,15 @@
+#include "prelude.h"
+
+int version = VERSION;
+const char* name = NAME;
+int sum = ADD(1, VERSION);
+const char* str = STR(ADD(x, y));
+int CAT(var, 1) = 0;
+int line = WHERE;
+#ifdef TEMPORARY
+int temporary = TEMPORARY;
+#endif
+#ifdef PRELUDE_H
+int guarded = 1;
+#endif
+int second = __COUNTER__;
@@ -0,0 +1,15 @@
+#ifndef PRELUDE_H
+#define PRELUDE_H
+
+#define VERSION 42
+#define NAME "prelude"
+#define ADD(a, b) ((a) + (b))
+#define STR(x) #x
+#define CAT(a, b) a ## b
+#define WHERE __LINE__
+#define TEMPORARY 1
+#undef TEMPORARY
+
+int first = __COUNTER__;
+
+#endif
@@ -0,0 +1,12 @@
+#include "prelude.h"
+
+int prelude_twice(int value)
+{
+    return value * 2;
+}
+
+int main()
+{
+    int result = prelude_value == EXPECTED;
+    return !result; // exit code of 0 (false) means success.
+}
@@ -0,0 +1,9 @@
+#ifndef PRELUDE_H
+#define PRELUDE_H
+
+#define EXPECTED 42
+
+int prelude_value = 42;
+int prelude_twice(int value);
+
+#endif
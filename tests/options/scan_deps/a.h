@@ -0,0 +1,10 @@
+#ifndef A_H
+#define A_H
+
+#define HEADER_B "b.h"
+#define USE_C 1
+
+/* #include "not_included.h" */
+const char* text = "#include \"not_included.h\"";
+
+#endif
@@ -0,0 +1,13 @@
+#include "a.h"
+#include HEADER_B
+
+int main()
+{
+#if 0
+#include "not_included.h"
+#elif defined(A_H) && USE_C > 0
+    return 0;
+#endif
+}
+
+#include "a.h"
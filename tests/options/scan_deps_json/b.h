@@ -0,0 +1,6 @@
+int b = 0;
+#if USE_C
+    #include "c.h"
+#else
+    #include "not_included.h"
+#endif
@@ -0,0 +1,11 @@
+#define MODE 1
+#include "skip_block.h"
+#undef MODE
+#define MODE 2
+#include "skip_block.h"
+#undef MODE
+#define MODE 3
+#include "skip_block.h"
+#undef MODE
+#define MODE 2
+#include "skip_block.h"
@@ -0,0 +1,13 @@
+#define COMPAT(x) x == 2
+#include "memoized_if.h"
+#include "memoized_if.h"
+#define VERSION 2
+#define FEATURE
+#include "memoized_if.h"
+#include "memoized_if.h"
+#undef COMPAT
+#define COMPAT(x) 0
+#include "memoized_if.h"
+#undef VERSION
+#define VERSION 3
+#include "memoized_if.h"
@@ -0,0 +1,13 @@
+#if defined(VERSION) && VERSION >= 3
+int recent = VERSION;
+#elif COMPAT(VERSION)
+int compatible = VERSION;
+#else
+int old = 0;
+#endif
+#ifdef FEATURE
+int feature = 1;
+#endif
+#if __LINE__ > 10
+int line = __LINE__;
+#endif
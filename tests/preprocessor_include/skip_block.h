@@ -0,0 +1,17 @@
+#if MODE == 1
+int one = __LINE__;
+#if 1
+  /* #endif */
+  "#endif"
+#endif
+#elif MODE == 2
+int two = __LINE__;
+#ifdef UNDEFINED
+int undefined = 0;
+#else
+int defined = __LINE__;
+#endif
+#else
+int other = __LINE__;
+#endif
+int after = __LINE__;